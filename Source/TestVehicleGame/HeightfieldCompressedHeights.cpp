@@ -0,0 +1,245 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "HeightfieldCompressedHeights.h"
+#include "Async/ParallelFor.h"
+
+void FHeightfieldCompressedHeights::Compress(TConstArrayView<uint16> Heights, int32 InWidth, int32 InHeight)
+{
+	Reset();
+	if (InWidth < 1 || InHeight < 1 || Heights.Num() != InWidth * InHeight)
+	{
+		return;
+	}
+
+	Width = InWidth;
+	Height = InHeight;
+	NumBlocksX = FMath::DivideAndRoundUp(Width, BlockSize);
+	NumBlocksY = FMath::DivideAndRoundUp(Height, BlockSize);
+	Blocks.SetNum(NumBlocksX * NumBlocksY);
+
+	// Size every block first, so the rows of blocks can then be packed in parallel
+	for (int32 BlockY = 0; BlockY < NumBlocksY; ++BlockY)
+	{
+		for (int32 BlockX = 0; BlockX < NumBlocksX; ++BlockX)
+		{
+			uint16 MinHeight = MAX_uint16;
+			uint16 MaxHeight = 0;
+			for (int32 Y = BlockY * BlockSize; Y < FMath::Min((BlockY + 1) * BlockSize, Height); ++Y)
+			{
+				for (int32 X = BlockX * BlockSize; X < FMath::Min((BlockX + 1) * BlockSize, Width); ++X)
+				{
+					MinHeight = FMath::Min(MinHeight, Heights[Y * Width + X]);
+					MaxHeight = FMath::Max(MaxHeight, Heights[Y * Width + X]);
+				}
+			}
+
+			FBlock& Block = Blocks[BlockY * NumBlocksX + BlockX];
+			Block.Base = MinHeight;
+			Block.Bits = MaxHeight > MinHeight ? static_cast<uint8>(FMath::FloorLog2(MaxHeight - MinHeight) + 1) : 0;
+			Block.CapacityBits = Block.Bits;
+			Block.Offset = Words.Num();
+			Words.AddUninitialized(GetNumBlockWords(Block.Bits));
+		}
+	}
+
+	ParallelFor(NumBlocksY, [this, Heights](int32 BlockY)
+	{
+		uint16 BlockHeights[SamplesPerBlock];
+		for (int32 BlockX = 0; BlockX < NumBlocksX; ++BlockX)
+		{
+			GatherBlock(Heights, BlockX, BlockY, BlockHeights);
+			EncodeBlock(Blocks[BlockY * NumBlocksX + BlockX], BlockHeights);
+		}
+	});
+}
+
+void FHeightfieldCompressedHeights::Reset()
+{
+	Blocks.Empty();
+	Words.Empty();
+	UnusedWords = 0;
+	Width = Height = NumBlocksX = NumBlocksY = 0;
+}
+
+void FHeightfieldCompressedHeights::GatherBlock(TConstArrayView<uint16> Heights, int32 BlockX, int32 BlockY, uint16* OutHeights) const
+{
+	for (int32 Y = 0; Y < BlockSize; ++Y)
+	{
+		const int32 SourceY = FMath::Min(BlockY * BlockSize + Y, Height - 1);
+		for (int32 X = 0; X < BlockSize; ++X)
+		{
+			const int32 SourceX = FMath::Min(BlockX * BlockSize + X, Width - 1);
+			OutHeights[Y * BlockSize + X] = Heights[SourceY * Width + SourceX];
+		}
+	}
+}
+
+void FHeightfieldCompressedHeights::EncodeBlock(FBlock& Block, const uint16* BlockHeights)
+{
+	uint16 MinHeight = MAX_uint16;
+	uint16 MaxHeight = 0;
+	for (int32 i = 0; i < SamplesPerBlock; ++i)
+	{
+		MinHeight = FMath::Min(MinHeight, BlockHeights[i]);
+		MaxHeight = FMath::Max(MaxHeight, BlockHeights[i]);
+	}
+
+	Block.Base = MinHeight;
+	Block.Bits = MaxHeight > MinHeight ? static_cast<uint8>(FMath::FloorLog2(MaxHeight - MinHeight) + 1) : 0;
+
+	// Grown past its words, move to new ones at the end
+	if (Block.Bits > Block.CapacityBits)
+	{
+		UnusedWords += GetNumBlockWords(Block.CapacityBits);
+		Block.Offset = Words.Num();
+		Block.CapacityBits = Block.Bits;
+		Words.AddUninitialized(GetNumBlockWords(Block.Bits));
+	}
+
+	if (Block.Bits == 0)
+	{
+		return;
+	}
+
+	// Residuals are packed back to back, a word is flushed whenever it fills up
+	uint64* Payload = &Words[Block.Offset];
+	uint64 Accumulator = 0;
+	uint32 AccumulatedBits = 0;
+	for (int32 i = 0; i < SamplesPerBlock; ++i)
+	{
+		const uint64 Residual = BlockHeights[i] - MinHeight;
+		Accumulator |= Residual << AccumulatedBits;
+		AccumulatedBits += Block.Bits;
+		if (AccumulatedBits >= 64)
+		{
+			*Payload++ = Accumulator;
+			AccumulatedBits -= 64;
+			Accumulator = AccumulatedBits > 0 ? Residual >> (Block.Bits - AccumulatedBits) : 0;
+		}
+	}
+}
+
+void FHeightfieldCompressedHeights::DecodeBlock(int32 BlockX, int32 BlockY, uint16* OutHeights) const
+{
+	const FBlock& Block = Blocks[BlockY * NumBlocksX + BlockX];
+	if (Block.Bits == 0)
+	{
+		for (int32 i = 0; i < SamplesPerBlock; ++i)
+		{
+			OutHeights[i] = Block.Base;
+		}
+		return;
+	}
+
+	// Mirror of the packing in EncodeBlock: refill from the next word whenever the current one runs out
+	const uint64* Payload = &Words[Block.Offset];
+	const uint64 Mask = (1ull << Block.Bits) - 1;
+	uint64 Accumulator = *Payload++;
+	uint32 AvailableBits = 64;
+	for (int32 i = 0; i < SamplesPerBlock; ++i)
+	{
+		uint64 Value = Accumulator;
+		if (AvailableBits < Block.Bits)
+		{
+			// The residual continues in the next word
+			Accumulator = *Payload++;
+			Value |= Accumulator << AvailableBits;
+			Accumulator >>= Block.Bits - AvailableBits;
+			AvailableBits += 64 - Block.Bits;
+		}
+		else
+		{
+			Accumulator >>= Block.Bits;
+			AvailableBits -= Block.Bits;
+			if (AvailableBits == 0 && i + 1 < SamplesPerBlock)
+			{
+				Accumulator = *Payload++;
+				AvailableBits = 64;
+			}
+		}
+		OutHeights[i] = static_cast<uint16>(Block.Base + (Value & Mask));
+	}
+}
+
+void FHeightfieldCompressedHeights::CopyRegion(int32 StartRow, int32 StartCol, int32 NumRows, int32 NumCols, TArrayView<uint16> OutHeights) const
+{
+	check(OutHeights.Num() == NumRows * NumCols);
+
+	// Whole blocks are decoded once and their overlap with the region copied out row by row
+	uint16 BlockHeights[SamplesPerBlock];
+	for (int32 BlockY = StartRow / BlockSize; BlockY <= (StartRow + NumRows - 1) / BlockSize; ++BlockY)
+	{
+		for (int32 BlockX = StartCol / BlockSize; BlockX <= (StartCol + NumCols - 1) / BlockSize; ++BlockX)
+		{
+			DecodeBlock(BlockX, BlockY, BlockHeights);
+
+			const int32 X0 = FMath::Max(StartCol, BlockX * BlockSize);
+			const int32 X1 = FMath::Min(StartCol + NumCols, (BlockX + 1) * BlockSize);
+			const int32 Y0 = FMath::Max(StartRow, BlockY * BlockSize);
+			const int32 Y1 = FMath::Min(StartRow + NumRows, (BlockY + 1) * BlockSize);
+			for (int32 Y = Y0; Y < Y1; ++Y)
+			{
+				FMemory::Memcpy(
+					&OutHeights[(Y - StartRow) * NumCols + (X0 - StartCol)],
+					&BlockHeights[(Y - BlockY * BlockSize) * BlockSize + (X0 - BlockX * BlockSize)],
+					(X1 - X0) * sizeof(uint16));
+			}
+		}
+	}
+}
+
+void FHeightfieldCompressedHeights::EditRegion(TConstArrayView<uint16> NewHeights, int32 StartRow, int32 StartCol, int32 NumRows, int32 NumCols)
+{
+	check(NewHeights.Num() == NumRows * NumCols);
+
+	uint16 BlockHeights[SamplesPerBlock];
+	const int32 EndRow = StartRow + NumRows;
+	const int32 EndCol = StartCol + NumCols;
+	for (int32 BlockY = StartRow / BlockSize; BlockY <= (EndRow - 1) / BlockSize; ++BlockY)
+	{
+		for (int32 BlockX = StartCol / BlockSize; BlockX <= (EndCol - 1) / BlockSize; ++BlockX)
+		{
+			DecodeBlock(BlockX, BlockY, BlockHeights);
+
+			// Padding samples repeat the edge, so edits of the last row or column are copied into it too
+			for (int32 Y = 0; Y < BlockSize; ++Y)
+			{
+				const int32 SampleY = FMath::Min(BlockY * BlockSize + Y, Height - 1);
+				if (SampleY < StartRow || SampleY >= EndRow)
+				{
+					continue;
+				}
+				for (int32 X = 0; X < BlockSize; ++X)
+				{
+					const int32 SampleX = FMath::Min(BlockX * BlockSize + X, Width - 1);
+					if (SampleX >= StartCol && SampleX < EndCol)
+					{
+						BlockHeights[Y * BlockSize + X] = NewHeights[(SampleY - StartRow) * NumCols + (SampleX - StartCol)];
+					}
+				}
+			}
+
+			EncodeBlock(Blocks[BlockY * NumBlocksX + BlockX], BlockHeights);
+		}
+	}
+
+	// Repack once blocks that grew have left too many words behind
+	if (UnusedWords > Words.Num() / 4)
+	{
+		TArray<uint64> PackedWords;
+		PackedWords.Reserve(Words.Num() - UnusedWords);
+		for (FBlock& Block : Blocks)
+		{
+			const int32 NumWords = GetNumBlockWords(Block.Bits);
+			const int32 NewOffset = PackedWords.Num();
+			if (NumWords > 0)
+			{
+				PackedWords.Append(&Words[Block.Offset], NumWords);
+			}
+			Block.Offset = NewOffset;
+			Block.CapacityBits = Block.Bits;
+		}
+		Words = MoveTemp(PackedWords);
+		UnusedWords = 0;
+	}
+}
@@ -0,0 +1,103 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * 16-bit heights stored in BlockSize x BlockSize blocks, each as a base height plus
+ * bit-packed residuals just wide enough for the block's height range. Smooth terrain
+ * needs 4-8 bits per sample instead of 16, flat blocks none at all.
+ *
+ * Random access is O(1): a block header gives the base, the residual width and where
+ * the residuals start. Whole blocks decode in one pass for bulk reads.
+ *
+ * Blocks past the right and bottom edge are padded with the edge samples.
+ */
+class TESTVEHICLEGAME_API FHeightfieldCompressedHeights
+{
+public:
+	static constexpr int32 BlockSize = 16;
+	static constexpr int32 SamplesPerBlock = BlockSize * BlockSize;
+
+	/** Replaces the contents with row-major heights of the given size */
+	void Compress(TConstArrayView<uint16> Heights, int32 InWidth, int32 InHeight);
+
+	void Reset();
+
+	bool IsEmpty() const { return Blocks.Num() == 0; }
+
+	int32 GetWidth() const { return Width; }
+	int32 GetHeight() const { return Height; }
+
+	uint16 GetHeightAt(int32 X, int32 Y) const
+	{
+		const FBlock& Block = Blocks[(Y / BlockSize) * NumBlocksX + X / BlockSize];
+		if (Block.Bits == 0)
+		{
+			return Block.Base;
+		}
+
+		// Residuals are at most 16 bits, so one can straddle two words at most
+		const uint32 BitIndex = ((Y % BlockSize) * BlockSize + X % BlockSize) * Block.Bits;
+		const uint64* Payload = &Words[Block.Offset + (BitIndex >> 6)];
+		const uint32 Shift = BitIndex & 63;
+		uint64 Value = Payload[0] >> Shift;
+		if (Shift + Block.Bits > 64)
+		{
+			Value |= Payload[1] << (64 - Shift);
+		}
+		return static_cast<uint16>(Block.Base + (Value & ((1ull << Block.Bits) - 1)));
+	}
+
+	/** Decodes a whole block, padding included, into SamplesPerBlock row-major heights */
+	void DecodeBlock(int32 BlockX, int32 BlockY, uint16* OutHeights) const;
+
+	/** Copies a region (row-major, NumRows * NumCols) that lies inside the heightfield */
+	void CopyRegion(int32 StartRow, int32 StartCol, int32 NumRows, int32 NumCols, TArrayView<uint16> OutHeights) const;
+
+	/**
+	 * Overwrites a region that lies inside the heightfield and re-encodes the blocks it touches.
+	 * Grown blocks move and the words get repacked, so no other thread may read while this runs
+	 * (FHeightfieldData edits under its write lock, readers on other threads hold its read lock).
+	 */
+	void EditRegion(TConstArrayView<uint16> NewHeights, int32 StartRow, int32 StartCol, int32 NumRows, int32 NumCols);
+
+	SIZE_T GetAllocatedSize() const { return Blocks.GetAllocatedSize() + Words.GetAllocatedSize(); }
+
+private:
+	struct FBlock
+	{
+		/** First word of the residuals */
+		uint32 Offset = 0;
+
+		/** Smallest height of the block, residuals are relative to it */
+		uint16 Base = 0;
+
+		/** Bits per residual, 0 for a flat block */
+		uint8 Bits = 0;
+
+		/** Residual width the words at Offset were allocated for, edits that fit reuse them */
+		uint8 CapacityBits = 0;
+	};
+
+	/** Words of residuals of a block with the given residual width */
+	static int32 GetNumBlockWords(int32 Bits) { return Bits * SamplesPerBlock / 64; }
+
+	/** Encodes SamplesPerBlock row-major heights into a block, reusing its words if they are wide enough */
+	void EncodeBlock(FBlock& Block, const uint16* BlockHeights);
+
+	/** Gathers the heights of a block from a row-major source, replicating the edge samples into the padding */
+	void GatherBlock(TConstArrayView<uint16> Heights, int32 BlockX, int32 BlockY, uint16* OutHeights) const;
+
+	TArray<FBlock> Blocks;
+	TArray<uint64> Words;
+
+	/** Words left behind by blocks that outgrew them */
+	int32 UnusedWords = 0;
+
+	int32 Width = 0;
+	int32 Height = 0;
+	int32 NumBlocksX = 0;
+	int32 NumBlocksY = 0;
+};
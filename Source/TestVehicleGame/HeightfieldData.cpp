@@ -0,0 +1,751 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "HeightfieldData.h"
+#include "Engine/Texture2D.h"
+#include "Engine/World.h"
+#include "Engine/Engine.h"
+#include "Async/ParallelFor.h"
+#include "Misc/ScopeRWLock.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/App.h"
+#include "Math/RandomStream.h"
+
+#if PLATFORM_ENABLE_VECTORINTRINSICS_NEON
+	#define HEIGHTFIELD_DECODE_NEON 1
+	#include <arm_neon.h>
+#elif PLATFORM_ENABLE_VECTORINTRINSICS && PLATFORM_ALWAYS_HAS_SSE4_1
+	#define HEIGHTFIELD_DECODE_SSE 1
+	#include <tmmintrin.h>
+#endif
+
+#ifndef HEIGHTFIELD_DECODE_NEON
+	#define HEIGHTFIELD_DECODE_NEON 0
+#endif
+#ifndef HEIGHTFIELD_DECODE_SSE
+	#define HEIGHTFIELD_DECODE_SSE 0
+#endif
+
+// Texture rows decoded per parallel task
+static constexpr int32 HEIGHTFIELD_DECODE_ROWS_PER_BAND = 64;
+
+static TAutoConsoleVariable<bool> CVarHeightfieldCompressHeights(
+	TEXT("HeightfieldData.CompressHeights"),
+	false,
+	TEXT("Keep the heights of newly created heightfield data block-compressed, about 2-4x smaller for typical terrain"),
+	ECVF_Default);
+
+/** Mip 0 of a BGRA8 heightmap texture, or null if the texture can't be used as a heightmap */
+static const FTexture2DMipMap* GetHeightmapMip(const UTexture2D* Texture)
+{
+	const FTexturePlatformData* PlatformData = Texture ? Texture->GetPlatformData() : nullptr;
+	if (!PlatformData || PlatformData->Mips.Num() == 0)
+	{
+		return nullptr;
+	}
+
+	if (PlatformData->PixelFormat != PF_B8G8R8A8)
+	{
+		UE_LOG(LogTemp, Error, TEXT("HeightfieldData: Texture %s must be BGRA8 format (got %d). Set CompressionSettings=VectorDisplacementmap or UserInterface2D, and SRGB=false."),
+			*Texture->GetName(), static_cast<int32>(PlatformData->PixelFormat));
+		return nullptr;
+	}
+
+	return &PlatformData->Mips[0];
+}
+
+/** Decodes height (B high byte, G low byte) and material index (R) of one BGRA8 pixel */
+static FORCEINLINE void DecodePixel(const uint8* Pixel, uint16& OutHeight, uint8& OutMaterialIndex)
+{
+	OutHeight = (static_cast<uint16>(Pixel[0]) << 8) | static_cast<uint16>(Pixel[1]);
+	OutMaterialIndex = Pixel[2];
+}
+
+/** Decodes a run of BGRA8 pixels one at a time */
+static void DecodePixelsScalar(const uint8* Pixels, int32 NumPixels, uint16* OutHeights, uint8* OutMaterialIndices)
+{
+	for (int32 i = 0; i < NumPixels; ++i)
+	{
+		DecodePixel(&Pixels[i * 4], OutHeights[i], OutMaterialIndices[i]);
+	}
+}
+
+/** Decodes a run of BGRA8 pixels into heights and material indices in one pass, 16 pixels at a time with SSE or NEON */
+static void DecodePixels(const uint8* Pixels, int32 NumPixels, uint16* OutHeights, uint8* OutMaterialIndices)
+{
+	int32 i = 0;
+
+#if HEIGHTFIELD_DECODE_SSE
+	// Per 4 pixels: heights as little-endian (G, B) byte pairs in the low half, the R bytes after them
+	const __m128i Shuffle = _mm_setr_epi8(1, 0, 5, 4, 9, 8, 13, 12, 2, 6, 10, 14, -1, -1, -1, -1);
+	for (; i + 16 <= NumPixels; i += 16)
+	{
+		const __m128i* Source = reinterpret_cast<const __m128i*>(&Pixels[i * 4]);
+		const __m128i Pixels0 = _mm_shuffle_epi8(_mm_loadu_si128(Source + 0), Shuffle);
+		const __m128i Pixels1 = _mm_shuffle_epi8(_mm_loadu_si128(Source + 1), Shuffle);
+		const __m128i Pixels2 = _mm_shuffle_epi8(_mm_loadu_si128(Source + 2), Shuffle);
+		const __m128i Pixels3 = _mm_shuffle_epi8(_mm_loadu_si128(Source + 3), Shuffle);
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(&OutHeights[i]), _mm_unpacklo_epi64(Pixels0, Pixels1));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(&OutHeights[i + 8]), _mm_unpacklo_epi64(Pixels2, Pixels3));
+
+		// The high halves hold the material indices in their first 4 bytes, pack those together
+		const __m128i Materials01 = _mm_shuffle_epi32(_mm_unpackhi_epi64(Pixels0, Pixels1), _MM_SHUFFLE(3, 1, 2, 0));
+		const __m128i Materials23 = _mm_shuffle_epi32(_mm_unpackhi_epi64(Pixels2, Pixels3), _MM_SHUFFLE(3, 1, 2, 0));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(&OutMaterialIndices[i]), _mm_unpacklo_epi64(Materials01, Materials23));
+	}
+#elif HEIGHTFIELD_DECODE_NEON
+	for (; i + 16 <= NumPixels; i += 16)
+	{
+		// Deinterleaves B, G, R and A of 16 pixels into a register each
+		const uint8x16x4_t Channels = vld4q_u8(&Pixels[i * 4]);
+
+		// Interleaving G (low byte) with B (high byte) gives the little-endian heights
+		uint8x16x2_t HeightBytes;
+		HeightBytes.val[0] = Channels.val[1];
+		HeightBytes.val[1] = Channels.val[0];
+		vst2q_u8(reinterpret_cast<uint8*>(&OutHeights[i]), HeightBytes);
+		vst1q_u8(&OutMaterialIndices[i], Channels.val[2]);
+	}
+#endif
+
+	DecodePixelsScalar(&Pixels[i * 4], NumPixels - i, &OutHeights[i], &OutMaterialIndices[i]);
+}
+
+FHeightfieldDataPtr FHeightfieldData::CreateFromTexture(const UTexture2D* Texture)
+{
+	const FTexture2DMipMap* Mip = GetHeightmapMip(Texture);
+	if (!Mip)
+	{
+		return nullptr;
+	}
+
+	const uint8* PixelData = static_cast<const uint8*>(Mip->BulkData.LockReadOnly());
+	if (!PixelData)
+	{
+		UE_LOG(LogTemp, Error, TEXT("HeightfieldData: Failed to lock texture mip data of %s"), *Texture->GetName());
+		return nullptr;
+	}
+
+	FHeightfieldDataPtr Data = MakeShared<FHeightfieldData, ESPMode::ThreadSafe>();
+	Data->Width = Mip->SizeX;
+	Data->Height = Mip->SizeY;
+	Data->Heights.SetNumUninitialized(Data->Width * Data->Height);
+	Data->MaterialIndices.SetNumUninitialized(Data->Width * Data->Height);
+
+	// One band of rows per task
+	FHeightfieldData& DataRef = *Data;
+	const int32 NumBands = FMath::DivideAndRoundUp(DataRef.Height, HEIGHTFIELD_DECODE_ROWS_PER_BAND);
+	ParallelFor(NumBands, [&DataRef, PixelData](int32 BandIndex)
+	{
+		const int32 FirstRow = BandIndex * HEIGHTFIELD_DECODE_ROWS_PER_BAND;
+		const int32 EndRow = FMath::Min(FirstRow + HEIGHTFIELD_DECODE_ROWS_PER_BAND, DataRef.Height);
+		const int32 First = FirstRow * DataRef.Width;
+		DecodePixels(&PixelData[First * 4], (EndRow - FirstRow) * DataRef.Width, &DataRef.Heights[First], &DataRef.MaterialIndices[First]);
+	});
+
+	Mip->BulkData.Unlock();
+
+	Data->BuildMinMaxPyramid();
+	Data->ApplyStorageSettings();
+	return Data;
+}
+
+FGuid FHeightfieldData::GetTextureSourceId(const UTexture2D* Texture)
+{
+#if WITH_EDITORONLY_DATA
+	if (Texture && Texture->Source.IsValid())
+	{
+		return Texture->Source.GetId();
+	}
+#endif
+	return FGuid();
+}
+
+FHeightfieldDataPtr FHeightfieldData::CreateFromHeights(TArray<uint16>&& InHeights, TArray<uint8>&& InMaterialIndices, int32 InWidth, int32 InHeight)
+{
+	if (InHeights.Num() != InWidth * InHeight || InMaterialIndices.Num() != InWidth * InHeight)
+	{
+		return nullptr;
+	}
+
+	FHeightfieldDataPtr Data = MakeShared<FHeightfieldData, ESPMode::ThreadSafe>();
+	Data->Heights = MoveTemp(InHeights);
+	Data->MaterialIndices = MoveTemp(InMaterialIndices);
+	Data->Width = InWidth;
+	Data->Height = InHeight;
+	Data->BuildMinMaxPyramid();
+	Data->ApplyStorageSettings();
+	return Data;
+}
+
+FHeightfieldDataPtr FHeightfieldData::CreateCopy() const
+{
+	TArray<uint16> CopiedHeights;
+	CopiedHeights.SetNumUninitialized(Width * Height);
+	CopyHeights(0, 0, Height, Width, CopiedHeights);
+
+	TArray<uint8> CopiedMaterialIndices = MaterialIndices;
+	return CreateFromHeights(MoveTemp(CopiedHeights), MoveTemp(CopiedMaterialIndices), Width, Height);
+}
+
+FHeightfieldDataPtr FHeightfieldData::CreateSnapshot() const
+{
+	FHeightfieldDataPtr Data = MakeShared<FHeightfieldData, ESPMode::ThreadSafe>();
+	Data->Heights.SetNumUninitialized(Width * Height);
+	CopyHeights(0, 0, Height, Width, Data->Heights);
+	Data->MaterialIndices = MaterialIndices;
+	Data->ApronHeights = ApronHeights;
+	Data->Width = Width;
+	Data->Height = Height;
+	Data->Revision = Revision;
+	Data->MinMaxLevels = MinMaxLevels;
+	return Data;
+}
+
+bool FHeightfieldData::SetApronHeights(TArray<uint16>&& InApronHeights)
+{
+	if (InApronHeights.Num() != 2 * (Width + 2) + 2 * Height)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("HeightfieldData: Apron of %d heights doesn't fit %d x %d"), InApronHeights.Num(), Width, Height);
+		return false;
+	}
+
+	ApronHeights = MoveTemp(InApronHeights);
+	return true;
+}
+
+bool FHeightfieldData::EditHeights(TArrayView<const uint16> NewHeights, int32 StartRow, int32 StartCol, int32 NumRows, int32 NumCols)
+{
+	if (!WriteHeights(NewHeights, StartRow, StartCol, NumRows, NumCols))
+	{
+		return false;
+	}
+
+	RegionChangedEvent.Broadcast(StartRow, StartCol, NumRows, NumCols);
+	return true;
+}
+
+bool FHeightfieldData::WriteHeights(TArrayView<const uint16> NewHeights, int32 StartRow, int32 StartCol, int32 NumRows, int32 NumCols)
+{
+	check(IsInGameThread());
+
+	if (NewHeights.Num() != NumRows * NumCols || !IsValidRegion(StartRow, StartCol, NumRows, NumCols))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("HeightfieldData: Edit of region (%d,%d) + (%d,%d) with %d heights doesn't fit (%d,%d)"),
+			StartRow, StartCol, NumRows, NumCols, NewHeights.Num(), Height, Width);
+		return false;
+	}
+
+	{
+		FWriteScopeLock WriteLock(Lock);
+		if (IsCompressed())
+		{
+			CompressedHeights.EditRegion(NewHeights, StartRow, StartCol, NumRows, NumCols);
+		}
+		else
+		{
+			for (int32 Row = 0; Row < NumRows; ++Row)
+			{
+				FMemory::Memcpy(
+					&Heights[(StartRow + Row) * Width + StartCol],
+					&NewHeights[Row * NumCols],
+					NumCols * sizeof(uint16));
+			}
+		}
+
+		UpdateMinMaxPyramid(StartRow, StartCol, NumRows, NumCols);
+		++Revision;
+	}
+
+	return true;
+}
+
+bool FHeightfieldData::ReloadRegionFromTexture(const UTexture2D* Texture, int32 StartRow, int32 StartCol, int32 NumRows, int32 NumCols)
+{
+	check(IsInGameThread());
+
+	const FTexture2DMipMap* Mip = GetHeightmapMip(Texture);
+	if (!Mip || Mip->SizeX != Width || Mip->SizeY != Height || !IsValidRegion(StartRow, StartCol, NumRows, NumCols))
+	{
+		return false;
+	}
+
+	const uint8* PixelData = static_cast<const uint8*>(Mip->BulkData.LockReadOnly());
+	if (!PixelData)
+	{
+		return false;
+	}
+
+	{
+		FWriteScopeLock WriteLock(Lock);
+		if (IsCompressed())
+		{
+			// Decode the region on its own, then re-encode the blocks it touches
+			TArray<uint16> RegionHeights;
+			RegionHeights.SetNumUninitialized(NumRows * NumCols);
+			for (int32 Row = StartRow; Row < StartRow + NumRows; ++Row)
+			{
+				const int32 Index = Row * Width + StartCol;
+				DecodePixels(&PixelData[Index * 4], NumCols, &RegionHeights[(Row - StartRow) * NumCols], &MaterialIndices[Index]);
+			}
+			CompressedHeights.EditRegion(RegionHeights, StartRow, StartCol, NumRows, NumCols);
+		}
+		else
+		{
+			for (int32 Row = StartRow; Row < StartRow + NumRows; ++Row)
+			{
+				const int32 Index = Row * Width + StartCol;
+				DecodePixels(&PixelData[Index * 4], NumCols, &Heights[Index], &MaterialIndices[Index]);
+			}
+		}
+
+		UpdateMinMaxPyramid(StartRow, StartCol, NumRows, NumCols);
+		++Revision;
+	}
+
+	Mip->BulkData.Unlock();
+
+	RegionChangedEvent.Broadcast(StartRow, StartCol, NumRows, NumCols);
+	return true;
+}
+
+FArchive& operator<<(FArchive& Ar, FHeightfieldData& Data)
+{
+	Ar << Data.Width << Data.Height;
+
+	// Always stored uncompressed, compression is a runtime choice
+	if (Ar.IsSaving() && Data.IsCompressed())
+	{
+		TArray<uint16> Heights;
+		Heights.SetNumUninitialized(Data.Width * Data.Height);
+		Data.CopyHeights(0, 0, Data.Height, Data.Width, Heights);
+		Heights.BulkSerialize(Ar);
+	}
+	else
+	{
+		Data.Heights.BulkSerialize(Ar);
+	}
+	Data.MaterialIndices.BulkSerialize(Ar);
+
+	// The pyramid is cheap to rebuild compared to loading it
+	if (Ar.IsLoading())
+	{
+		Data.CompressedHeights.Reset();
+		Data.BuildMinMaxPyramid();
+		Data.ApplyStorageSettings();
+	}
+	return Ar;
+}
+
+void FHeightfieldData::ApplyStorageSettings()
+{
+	if (CVarHeightfieldCompressHeights.GetValueOnAnyThread() && !IsCompressed())
+	{
+		CompressHeights();
+	}
+}
+
+void FHeightfieldData::CompressHeights()
+{
+	if (IsCompressed() || Heights.Num() == 0)
+	{
+		return;
+	}
+
+	FWriteScopeLock WriteLock(Lock);
+	const SIZE_T RawSize = Heights.GetAllocatedSize();
+	CompressedHeights.Compress(Heights, Width, Height);
+	Heights.Empty();
+
+	UE_LOG(LogTemp, Log, TEXT("HeightfieldData: Compressed %d x %d heights from %llu to %llu bytes"),
+		Width, Height, static_cast<uint64>(RawSize), static_cast<uint64>(CompressedHeights.GetAllocatedSize()));
+}
+
+void FHeightfieldData::CopyHeights(int32 StartRow, int32 StartCol, int32 NumRows, int32 NumCols, TArrayView<uint16> OutHeights) const
+{
+	check(IsValidRegion(StartRow, StartCol, NumRows, NumCols) && OutHeights.Num() == NumRows * NumCols);
+
+	if (IsCompressed())
+	{
+		CompressedHeights.CopyRegion(StartRow, StartCol, NumRows, NumCols, OutHeights);
+		return;
+	}
+
+	for (int32 Row = 0; Row < NumRows; ++Row)
+	{
+		FMemory::Memcpy(&OutHeights[Row * NumCols], &Heights[(StartRow + Row) * Width + StartCol], NumCols * sizeof(uint16));
+	}
+}
+
+SIZE_T FHeightfieldData::GetAllocatedSize() const
+{
+	SIZE_T Size = Heights.GetAllocatedSize() + CompressedHeights.GetAllocatedSize() +
+		MaterialIndices.GetAllocatedSize() + ApronHeights.GetAllocatedSize() + MinMaxLevels.GetAllocatedSize();
+	for (const FMinMaxLevel& MinMaxLevel : MinMaxLevels)
+	{
+		Size += MinMaxLevel.Nodes.GetAllocatedSize();
+	}
+	return Size;
+}
+
+void FHeightfieldData::BuildMinMaxPyramid()
+{
+	MinMaxLevels.Reset();
+	if (Heights.Num() == 0)
+	{
+		return;
+	}
+
+	// Leaves, then halve the node count per level until a single root is left
+	FIntPoint Size(
+		FMath::Max(1, FMath::DivideAndRoundUp(Width - 1, MinMaxLeafSize)),
+		FMath::Max(1, FMath::DivideAndRoundUp(Height - 1, MinMaxLeafSize)));
+	for (;;)
+	{
+		FMinMaxLevel& MinMaxLevel = MinMaxLevels.AddDefaulted_GetRef();
+		MinMaxLevel.Size = Size;
+		MinMaxLevel.Nodes.SetNum(Size.X * Size.Y);
+		if (Size.X == 1 && Size.Y == 1)
+		{
+			break;
+		}
+		Size = FIntPoint(FMath::DivideAndRoundUp(Size.X, 2), FMath::DivideAndRoundUp(Size.Y, 2));
+	}
+
+	const FIntPoint LeafSize = MinMaxLevels[0].Size;
+	ParallelFor(LeafSize.Y, [this, LeafSize](int32 NodeY)
+	{
+		for (int32 NodeX = 0; NodeX < LeafSize.X; ++NodeX)
+		{
+			UpdateMinMaxLeaf(NodeX, NodeY);
+		}
+	});
+
+	for (int32 Level = 1; Level < MinMaxLevels.Num(); ++Level)
+	{
+		const FIntPoint LevelSize = MinMaxLevels[Level].Size;
+		for (int32 NodeY = 0; NodeY < LevelSize.Y; ++NodeY)
+		{
+			for (int32 NodeX = 0; NodeX < LevelSize.X; ++NodeX)
+			{
+				UpdateMinMaxParent(Level, NodeX, NodeY);
+			}
+		}
+	}
+}
+
+void FHeightfieldData::UpdateMinMaxPyramid(int32 StartRow, int32 StartCol, int32 NumRows, int32 NumCols)
+{
+	if (MinMaxLevels.Num() == 0)
+	{
+		return;
+	}
+
+	// Border samples are shared with the leaf before them
+	const FIntPoint LeafSize = MinMaxLevels[0].Size;
+	int32 MinNodeX = FMath::Max(0, (StartCol - 1) / MinMaxLeafSize);
+	int32 MinNodeY = FMath::Max(0, (StartRow - 1) / MinMaxLeafSize);
+	int32 MaxNodeX = FMath::Min(LeafSize.X - 1, (StartCol + NumCols - 1) / MinMaxLeafSize);
+	int32 MaxNodeY = FMath::Min(LeafSize.Y - 1, (StartRow + NumRows - 1) / MinMaxLeafSize);
+
+	for (int32 NodeY = MinNodeY; NodeY <= MaxNodeY; ++NodeY)
+	{
+		for (int32 NodeX = MinNodeX; NodeX <= MaxNodeX; ++NodeX)
+		{
+			UpdateMinMaxLeaf(NodeX, NodeY);
+		}
+	}
+
+	for (int32 Level = 1; Level < MinMaxLevels.Num(); ++Level)
+	{
+		MinNodeX /= 2;
+		MinNodeY /= 2;
+		MaxNodeX /= 2;
+		MaxNodeY /= 2;
+		for (int32 NodeY = MinNodeY; NodeY <= MaxNodeY; ++NodeY)
+		{
+			for (int32 NodeX = MinNodeX; NodeX <= MaxNodeX; ++NodeX)
+			{
+				UpdateMinMaxParent(Level, NodeX, NodeY);
+			}
+		}
+	}
+}
+
+void FHeightfieldData::UpdateMinMaxLeaf(int32 NodeX, int32 NodeY)
+{
+	const FIntRect Samples = GetMinMaxNodeSamples(0, NodeX, NodeY);
+
+	FHeightfieldHeightRange Range;
+	for (int32 Y = Samples.Min.Y; Y <= Samples.Max.Y; ++Y)
+	{
+		for (int32 X = Samples.Min.X; X <= Samples.Max.X; ++X)
+		{
+			Range.Add(GetHeightAt(X, Y));
+		}
+	}
+
+	FMinMaxLevel& Leaves = MinMaxLevels[0];
+	Leaves.Nodes[NodeY * Leaves.Size.X + NodeX] = Range;
+}
+
+void FHeightfieldData::UpdateMinMaxParent(int32 Level, int32 NodeX, int32 NodeY)
+{
+	const FMinMaxLevel& Children = MinMaxLevels[Level - 1];
+
+	FHeightfieldHeightRange Range;
+	for (int32 ChildY = NodeY * 2; ChildY < FMath::Min(NodeY * 2 + 2, Children.Size.Y); ++ChildY)
+	{
+		for (int32 ChildX = NodeX * 2; ChildX < FMath::Min(NodeX * 2 + 2, Children.Size.X); ++ChildX)
+		{
+			Range.Add(Children.Nodes[ChildY * Children.Size.X + ChildX]);
+		}
+	}
+
+	FMinMaxLevel& MinMaxLevel = MinMaxLevels[Level];
+	MinMaxLevel.Nodes[NodeY * MinMaxLevel.Size.X + NodeX] = Range;
+}
+
+FHeightfieldHeightRange FHeightfieldData::GetHeightRange() const
+{
+	return MinMaxLevels.Num() > 0 ? MinMaxLevels.Last().Nodes[0] : FHeightfieldHeightRange();
+}
+
+FHeightfieldHeightRange FHeightfieldData::GetHeightRange(int32 MinX, int32 MinY, int32 MaxX, int32 MaxY) const
+{
+	FHeightfieldHeightRange Range;
+	const FIntRect Samples(
+		FMath::Max(MinX, 0), FMath::Max(MinY, 0),
+		FMath::Min(MaxX, Width - 1), FMath::Min(MaxY, Height - 1));
+	if (MinMaxLevels.Num() > 0 && Samples.Min.X <= Samples.Max.X && Samples.Min.Y <= Samples.Max.Y)
+	{
+		GatherHeightRange(MinMaxLevels.Num() - 1, 0, 0, Samples, Range);
+	}
+	return Range;
+}
+
+void FHeightfieldData::GatherHeightRange(int32 Level, int32 NodeX, int32 NodeY, const FIntRect& Samples, FHeightfieldHeightRange& OutRange) const
+{
+	const FIntRect NodeSamples = GetMinMaxNodeSamples(Level, NodeX, NodeY);
+	const FIntRect Overlap(
+		FMath::Max(NodeSamples.Min.X, Samples.Min.X), FMath::Max(NodeSamples.Min.Y, Samples.Min.Y),
+		FMath::Min(NodeSamples.Max.X, Samples.Max.X), FMath::Min(NodeSamples.Max.Y, Samples.Max.Y));
+	if (Overlap.Min.X > Overlap.Max.X || Overlap.Min.Y > Overlap.Max.Y)
+	{
+		return;
+	}
+
+	// Whole node inside the rectangle, or nothing in it can widen the range any further
+	const FHeightfieldHeightRange& NodeRange = GetMinMaxNode(Level, NodeX, NodeY);
+	if (Overlap == NodeSamples || (NodeRange.Min >= OutRange.Min && NodeRange.Max <= OutRange.Max))
+	{
+		OutRange.Add(NodeRange);
+		return;
+	}
+
+	if (Level == 0)
+	{
+		for (int32 Y = Overlap.Min.Y; Y <= Overlap.Max.Y; ++Y)
+		{
+			for (int32 X = Overlap.Min.X; X <= Overlap.Max.X; ++X)
+			{
+				OutRange.Add(GetHeightAt(X, Y));
+			}
+		}
+		return;
+	}
+
+	const FIntPoint ChildSize = MinMaxLevels[Level - 1].Size;
+	for (int32 ChildY = NodeY * 2; ChildY < FMath::Min(NodeY * 2 + 2, ChildSize.Y); ++ChildY)
+	{
+		for (int32 ChildX = NodeX * 2; ChildX < FMath::Min(NodeX * 2 + 2, ChildSize.X); ++ChildX)
+		{
+			GatherHeightRange(Level - 1, ChildX, ChildY, Samples, OutRange);
+		}
+	}
+}
+
+/** Decodes a texture, or copies the heights kept for it if an earlier world released its CPU copy */
+static FHeightfieldDataPtr CreateHeightfieldData(const UTexture2D* Texture)
+{
+	const UHeightfieldTextureSourceSubsystem* SourceSubsystem = UHeightfieldTextureSourceSubsystem::Get();
+	if (SourceSubsystem && SourceSubsystem->IsReleased(Texture))
+	{
+		return SourceSubsystem->CopyReleasedSource(Texture);
+	}
+	return FHeightfieldData::CreateFromTexture(Texture);
+}
+
+FHeightfieldDataPtr UHeightfieldDataSubsystem::GetHeightfieldData(const UTexture2D* Texture)
+{
+	if (FHeightfieldDataPtr Existing = FindHeightfieldData(Texture))
+	{
+		return Existing;
+	}
+
+	FHeightfieldDataPtr Data = CreateHeightfieldData(Texture);
+	if (Data.IsValid())
+	{
+		DecodedData.Add(Texture, Data);
+		DataSharedEvent.Broadcast(Texture, Data);
+	}
+	return Data;
+}
+
+FHeightfieldDataPtr UHeightfieldDataSubsystem::FindHeightfieldData(const UTexture2D* Texture) const
+{
+	const TWeakPtr<FHeightfieldData, ESPMode::ThreadSafe>* Found = Texture ? DecodedData.Find(Texture) : nullptr;
+	return Found ? Found->Pin() : nullptr;
+}
+
+FHeightfieldDataPtr UHeightfieldDataSubsystem::AddHeightfieldData(const UTexture2D* Texture, const FHeightfieldDataPtr& Data)
+{
+	if (!Texture || !Data.IsValid())
+	{
+		return Data;
+	}
+
+	if (FHeightfieldDataPtr Existing = FindHeightfieldData(Texture))
+	{
+		return Existing;
+	}
+
+	// Drop entries of data nobody uses anymore while we're here
+	for (auto It = DecodedData.CreateIterator(); It; ++It)
+	{
+		if (!It.Value().IsValid())
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	DecodedData.Add(Texture, Data);
+	DataSharedEvent.Broadcast(Texture, Data);
+	return Data;
+}
+
+FHeightfieldDataPtr UHeightfieldDataSubsystem::GetHeightfieldData(const UObject* WorldContextObject, const UTexture2D* Texture)
+{
+	const UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+	if (UHeightfieldDataSubsystem* Subsystem = World ? World->GetSubsystem<UHeightfieldDataSubsystem>() : nullptr)
+	{
+		return Subsystem->GetHeightfieldData(Texture);
+	}
+
+	return CreateHeightfieldData(Texture);
+}
+
+bool UHeightfieldDataSubsystem::IsRunningWithoutRenderer()
+{
+	// Commandlets can't render unless asked to, but the cooker still builds render data for cooked packages
+	return !IsRunningCommandlet() && (IsRunningDedicatedServer() || !FApp::CanEverRender());
+}
+
+void UHeightfieldDataSubsystem::ReleaseTextureSource(UTexture2D* Texture)
+{
+	const FHeightfieldDataPtr Data = FindHeightfieldData(Texture);
+	FTexturePlatformData* PlatformData = Texture ? Texture->GetPlatformData() : nullptr;
+	UHeightfieldTextureSourceSubsystem* SourceSubsystem = UHeightfieldTextureSourceSubsystem::Get();
+	if (!Data.IsValid() || !PlatformData || !SourceSubsystem || PinnedData.Contains(Texture))
+	{
+		return;
+	}
+
+	// Released by an earlier world already, this world started from the kept heights
+	if (SourceSubsystem->IsReleased(Texture))
+	{
+		PinnedData.Add(Texture, Data);
+		return;
+	}
+
+	// Later worlds need the unedited heights, which only exist until the first edit
+	if (!SourceSubsystem->AddReleasedSource(Texture, *Data))
+	{
+		return;
+	}
+
+	PinnedData.Add(Texture, Data);
+
+	int64 FreedBytes = 0;
+	for (FTexture2DMipMap& Mip : PlatformData->Mips)
+	{
+		FreedBytes += Mip.BulkData.GetBulkDataSize();
+		Mip.BulkData.RemoveBulkData();
+	}
+
+	UE_LOG(LogTemp, Log, TEXT("HeightfieldData: Released the CPU copy of %s (%lld KB), its decoded heights are kept instead"),
+		*Texture->GetName(), FreedBytes / 1024);
+}
+
+UHeightfieldTextureSourceSubsystem* UHeightfieldTextureSourceSubsystem::Get()
+{
+	return GEngine ? GEngine->GetEngineSubsystem<UHeightfieldTextureSourceSubsystem>() : nullptr;
+}
+
+bool UHeightfieldTextureSourceSubsystem::AddReleasedSource(const UTexture2D* Texture, const FHeightfieldData& Data)
+{
+	if (!Texture || Data.GetRevision() != 0)
+	{
+		return false;
+	}
+
+	// Drop the heights of textures that were unloaded meanwhile
+	for (auto It = ReleasedSources.CreateIterator(); It; ++It)
+	{
+		if (!It.Key().ResolveObjectPtr())
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	FHeightfieldDataPtr Source = Data.CreateCopy();
+	Source->CompressHeights();
+	ReleasedSources.Add(Texture, MoveTemp(Source));
+	return true;
+}
+
+FHeightfieldDataPtr UHeightfieldTextureSourceSubsystem::CopyReleasedSource(const UTexture2D* Texture) const
+{
+	const FHeightfieldDataPtr* Found = Texture ? ReleasedSources.Find(Texture) : nullptr;
+	return Found ? (*Found)->CreateCopy() : nullptr;
+}
+
+/** HeightfieldData.BenchmarkDecode [Size]: checks the vectorized pixel decode against the scalar one and times both */
+static void BenchmarkHeightfieldDecode(const TArray<FString>& Args)
+{
+	const int32 Size = Args.Num() > 0 ? FMath::Clamp(FCString::Atoi(*Args[0]), 1, 16384) : 8192;
+	const int32 NumPixels = Size * Size;
+
+	TArray<uint8> Pixels;
+	Pixels.SetNumUninitialized(NumPixels * 4);
+	FRandomStream Random(Size);
+	for (uint8& Byte : Pixels)
+	{
+		Byte = static_cast<uint8>(Random.RandHelper(256));
+	}
+
+	TArray<uint16> ScalarHeights, VectorHeights;
+	TArray<uint8> ScalarMaterials, VectorMaterials;
+	ScalarHeights.SetNumUninitialized(NumPixels);
+	VectorHeights.SetNumUninitialized(NumPixels);
+	ScalarMaterials.SetNumUninitialized(NumPixels);
+	VectorMaterials.SetNumUninitialized(NumPixels);
+
+	double StartTime = FPlatformTime::Seconds();
+	DecodePixelsScalar(Pixels.GetData(), NumPixels, ScalarHeights.GetData(), ScalarMaterials.GetData());
+	const double ScalarTime = FPlatformTime::Seconds() - StartTime;
+
+	StartTime = FPlatformTime::Seconds();
+	DecodePixels(Pixels.GetData(), NumPixels, VectorHeights.GetData(), VectorMaterials.GetData());
+	const double VectorTime = FPlatformTime::Seconds() - StartTime;
+
+	const bool bMatches = ScalarHeights == VectorHeights && ScalarMaterials == VectorMaterials;
+	UE_LOG(LogTemp, Log, TEXT("HeightfieldData: Decoded %d x %d pixels: scalar %.2f ms, %s %.2f ms. Results %s"),
+		Size, Size, ScalarTime * 1000.0, HEIGHTFIELD_DECODE_SSE ? TEXT("SSE") : HEIGHTFIELD_DECODE_NEON ? TEXT("NEON") : TEXT("scalar"),
+		VectorTime * 1000.0, bMatches ? TEXT("match") : TEXT("DIFFER"));
+}
+
+static FAutoConsoleCommand GHeightfieldDecodeBenchmarkCommand(
+	TEXT("HeightfieldData.BenchmarkDecode"),
+	TEXT("Checks the vectorized BGRA8 heightmap decode against the scalar one and times both. Optional argument: texture size (default 8192)."),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&BenchmarkHeightfieldDecode));
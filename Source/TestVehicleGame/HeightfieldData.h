@@ -0,0 +1,320 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Subsystems/EngineSubsystem.h"
+#include "UObject/ObjectKey.h"
+#include "HAL/CriticalSection.h"
+#include "HeightfieldCompressedHeights.h"
+#include "HeightfieldData.generated.h"
+
+class UTexture2D;
+
+/** Min and max of a set of raw 16-bit heights */
+struct FHeightfieldHeightRange
+{
+	uint16 Min = MAX_uint16;
+	uint16 Max = 0;
+
+	bool IsValid() const { return Min <= Max; }
+
+	void Add(uint16 Height)
+	{
+		Min = FMath::Min(Min, Height);
+		Max = FMath::Max(Max, Height);
+	}
+
+	void Add(const FHeightfieldHeightRange& Other)
+	{
+		Min = FMath::Min(Min, Other.Min);
+		Max = FMath::Max(Max, Other.Max);
+	}
+};
+
+/**
+ * Decoded contents of a BGRA8 heightmap texture, shared by every component that uses the texture.
+ *
+ * Texture format:
+ * - B + G channels = 16-bit height (B = high byte, G = low byte)
+ * - R channel = material index
+ *
+ * Heights can be edited at runtime; every edit is broadcast through OnRegionChanged so
+ * the mesh and the collision built from the same data stay in sync.
+ *
+ * Heights can be kept block-compressed (see FHeightfieldCompressedHeights) to save memory on large terrains,
+ * enabled with HeightfieldData.CompressHeights. Random access through GetHeightAt works either way; bulk
+ * readers use CopyHeights, since GetHeights is only filled while the heights are uncompressed.
+ *
+ * A min/max pyramid over the heights is kept up to date with every edit. Its leaves hold the
+ * height range of MinMaxLeafSize x MinMaxLeafSize cells, every level above merges 2x2 nodes
+ * of the level below, up to a single root node covering the whole heightfield.
+ */
+class TESTVEHICLEGAME_API FHeightfieldData
+{
+public:
+	/** Decodes mip 0 of a BGRA8 heightmap texture, returns null if the texture can't be used. Safe to call from any thread. */
+	static TSharedPtr<FHeightfieldData, ESPMode::ThreadSafe> CreateFromTexture(const UTexture2D* Texture);
+
+	/** Content id of the texture's source art, changes whenever the heights do. Invalid once the source is stripped in cooked builds */
+	static FGuid GetTextureSourceId(const UTexture2D* Texture);
+
+	/** Wraps already decoded heights and per-texel material indices (row-major, Width * Height each) */
+	static TSharedPtr<FHeightfieldData, ESPMode::ThreadSafe> CreateFromHeights(TArray<uint16>&& InHeights, TArray<uint8>&& InMaterialIndices, int32 InWidth, int32 InHeight);
+
+	/** Copy of the heights and material indices, without the apron. Stored as HeightfieldData.CompressHeights asks */
+	TSharedPtr<FHeightfieldData, ESPMode::ThreadSafe> CreateCopy() const;
+
+	/** Uncompressed copy of everything but the listeners, for a background build to read while edits go on. Off the game thread, hold the read lock */
+	TSharedPtr<FHeightfieldData, ESPMode::ThreadSafe> CreateSnapshot() const;
+
+	/** Number of samples along X (columns) */
+	int32 GetWidth() const { return Width; }
+
+	/** Number of samples along Y (rows) */
+	int32 GetHeight() const { return Height; }
+
+	/** 16-bit heights, row-major. Empty while the heights are compressed */
+	const TArray<uint16>& GetHeights() const { return Heights; }
+
+	/** True if the heights are block-compressed */
+	bool IsCompressed() const { return !CompressedHeights.IsEmpty(); }
+
+	/** Moves the heights into block-compressed storage */
+	void CompressHeights();
+
+	/** Copies the heights of a region that lies inside the heightfield (row-major, NumRows * NumCols), compressed or not */
+	void CopyHeights(int32 StartRow, int32 StartCol, int32 NumRows, int32 NumCols, TArrayView<uint16> OutHeights) const;
+
+	/** Memory held by heights, material indices and pyramid, in bytes */
+	SIZE_T GetAllocatedSize() const;
+
+	/** Material index (R channel) of every sample, row-major */
+	const TArray<uint8>& GetMaterialIndices() const { return MaterialIndices; }
+
+	uint16 GetHeightAt(int32 X, int32 Y) const
+	{
+		return Heights.Num() > 0 ? Heights[Y * Width + X] : CompressedHeights.GetHeightAt(X, Y);
+	}
+
+	/** Cells (sample intervals) covered by a leaf of the min/max pyramid along each axis */
+	static constexpr int32 MinMaxLeafSize = 4;
+
+	/** Range of all heights */
+	FHeightfieldHeightRange GetHeightRange() const;
+
+	/** Exact range of the heights in an inclusive sample rectangle, clamped to the heightfield */
+	FHeightfieldHeightRange GetHeightRange(int32 MinX, int32 MinY, int32 MaxX, int32 MaxY) const;
+
+	int32 GetNumMinMaxLevels() const { return MinMaxLevels.Num(); }
+
+	/** Number of nodes of a pyramid level along X and Y */
+	FIntPoint GetMinMaxLevelSize(int32 Level) const { return MinMaxLevels[Level].Size; }
+
+	/** Range of the heights covered by a pyramid node */
+	const FHeightfieldHeightRange& GetMinMaxNode(int32 Level, int32 NodeX, int32 NodeY) const
+	{
+		const FMinMaxLevel& MinMaxLevel = MinMaxLevels[Level];
+		return MinMaxLevel.Nodes[NodeY * MinMaxLevel.Size.X + NodeX];
+	}
+
+	/** Inclusive sample rectangle covered by a pyramid node; nodes share their border samples */
+	FIntRect GetMinMaxNodeSamples(int32 Level, int32 NodeX, int32 NodeY) const
+	{
+		const int32 NodeSize = MinMaxLeafSize << Level;
+		return FIntRect(
+			NodeX * NodeSize, NodeY * NodeSize,
+			FMath::Min((NodeX + 1) * NodeSize, Width - 1), FMath::Min((NodeY + 1) * NodeSize, Height - 1));
+	}
+
+	/**
+	 * Sets the heights of the ring of samples just outside the heightfield, for data cut out of a larger
+	 * heightfield: the row above and the row below (Width + 2 samples each, corners included), then the
+	 * column left and the column right (Height samples each). Lets the normals along the border match
+	 * the neighbouring pieces. Runtime only, not serialized; set it before the data is shared.
+	 */
+	bool SetApronHeights(TArray<uint16>&& InApronHeights);
+
+	bool HasApron() const { return ApronHeights.Num() > 0; }
+
+	/** Height of a sample one step outside the heightfield (X in [-1, Width], Y in [-1, Height]), needs an apron */
+	uint16 GetApronHeightAt(int32 X, int32 Y) const
+	{
+		if (Y < 0)
+		{
+			return ApronHeights[X + 1];
+		}
+		if (Y >= Height)
+		{
+			return ApronHeights[Width + 2 + X + 1];
+		}
+		return ApronHeights[2 * (Width + 2) + (X < 0 ? 0 : Height) + Y];
+	}
+
+	/** True if the region lies completely inside the heightfield */
+	bool IsValidRegion(int32 StartRow, int32 StartCol, int32 NumRows, int32 NumCols) const
+	{
+		return StartRow >= 0 && StartCol >= 0 && NumRows > 0 && NumCols > 0 &&
+			StartRow + NumRows <= Height && StartCol + NumCols <= Width;
+	}
+
+	/**
+	 * Overwrites the heights of a region and notifies listeners.
+	 *
+	 * @param NewHeights - New height values for the region (row-major order)
+	 * @return false if the region is out of bounds or doesn't match the number of heights
+	 */
+	bool EditHeights(TArrayView<const uint16> NewHeights, int32 StartRow, int32 StartCol, int32 NumRows, int32 NumCols);
+
+	/**
+	 * Same as EditHeights, but without notifying listeners, for batches of edits.
+	 * The writer calls NotifyRegionChanged for the regions it touched once the batch is done.
+	 */
+	bool WriteHeights(TArrayView<const uint16> NewHeights, int32 StartRow, int32 StartCol, int32 NumRows, int32 NumCols);
+
+	/** Tells listeners a region changed through WriteHeights */
+	void NotifyRegionChanged(int32 StartRow, int32 StartCol, int32 NumRows, int32 NumCols)
+	{
+		RegionChangedEvent.Broadcast(StartRow, StartCol, NumRows, NumCols);
+	}
+
+	/** Re-reads a region from the texture the data was decoded from (after the texture was modified) and notifies listeners */
+	bool ReloadRegionFromTexture(const UTexture2D* Texture, int32 StartRow, int32 StartCol, int32 NumRows, int32 NumCols);
+
+	/** Number of edits since the heights were decoded or loaded, 0 while they still match their source */
+	uint32 GetRevision() const { return Revision; }
+
+	/**
+	 * Held for writing while an edit modifies heights and pyramid. Every reader on another thread
+	 * (FHeightfieldQuery, background mesh and collision builds) must hold it for reading: edits of
+	 * compressed heights can reallocate their storage. The game thread, where edits happen, doesn't need to.
+	 */
+	FRWLock& GetLock() const { return Lock; }
+
+	/** Broadcast on the game thread after a region of heights changed: StartRow, StartCol, NumRows, NumCols */
+	DECLARE_MULTICAST_DELEGATE_FourParams(FOnRegionChanged, int32, int32, int32, int32);
+	FOnRegionChanged& OnRegionChanged() { return RegionChangedEvent; }
+
+	friend FArchive& operator<<(FArchive& Ar, FHeightfieldData& Data);
+
+private:
+	struct FMinMaxLevel
+	{
+		FIntPoint Size = FIntPoint::ZeroValue;
+		TArray<FHeightfieldHeightRange> Nodes;
+	};
+
+	/** Compresses the heights if HeightfieldData.CompressHeights asks for it */
+	void ApplyStorageSettings();
+
+	/** Builds the whole min/max pyramid from the heights */
+	void BuildMinMaxPyramid();
+
+	/** Recomputes the pyramid nodes covering an edited sample region */
+	void UpdateMinMaxPyramid(int32 StartRow, int32 StartCol, int32 NumRows, int32 NumCols);
+
+	/** Recomputes a leaf from the heights it covers */
+	void UpdateMinMaxLeaf(int32 NodeX, int32 NodeY);
+
+	/** Recomputes a node above the leaves from its children */
+	void UpdateMinMaxParent(int32 Level, int32 NodeX, int32 NodeY);
+
+	/** Merges the range of the heights a node shares with the (inclusive) sample rectangle into OutRange */
+	void GatherHeightRange(int32 Level, int32 NodeX, int32 NodeY, const FIntRect& Samples, FHeightfieldHeightRange& OutRange) const;
+
+	TArray<uint16> Heights;
+	FHeightfieldCompressedHeights CompressedHeights;
+	TArray<uint8> MaterialIndices;
+	TArray<uint16> ApronHeights;
+	int32 Width = 0;
+	int32 Height = 0;
+	uint32 Revision = 0;
+
+	/** Min/max pyramid, leaves first */
+	TArray<FMinMaxLevel> MinMaxLevels;
+
+	mutable FRWLock Lock;
+
+	FOnRegionChanged RegionChangedEvent;
+};
+
+using FHeightfieldDataPtr = TSharedPtr<FHeightfieldData, ESPMode::ThreadSafe>;
+
+/**
+ * Hands out the decoded data of heightmap textures, so a texture used by several
+ * components (typically a mesh and a collision component on the same actor) is
+ * decoded and held in memory only once. Data is released when no component uses it anymore.
+ */
+UCLASS()
+class TESTVEHICLEGAME_API UHeightfieldDataSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/** Data of a heightmap texture, decoded on first use */
+	FHeightfieldDataPtr GetHeightfieldData(const UTexture2D* Texture);
+
+	/** Data of a heightmap texture if it is already decoded, null otherwise */
+	FHeightfieldDataPtr FindHeightfieldData(const UTexture2D* Texture) const;
+
+	/**
+	 * Shares data decoded elsewhere (on a worker thread, or loaded from a cooked package).
+	 * Returns the data other components already use for the texture if there is any, else Data itself.
+	 */
+	FHeightfieldDataPtr AddHeightfieldData(const UTexture2D* Texture, const FHeightfieldDataPtr& Data);
+
+	/** Broadcast when the data of a texture starts being shared (decoded or added), before anyone can edit it */
+	DECLARE_MULTICAST_DELEGATE_TwoParams(FOnHeightfieldDataShared, const UTexture2D*, const FHeightfieldDataPtr&);
+	FOnHeightfieldDataShared& OnHeightfieldDataShared() { return DataSharedEvent; }
+
+	/** Shared data of a texture for a component, or a private copy if the component has no world */
+	static FHeightfieldDataPtr GetHeightfieldData(const UObject* WorldContextObject, const UTexture2D* Texture);
+
+	/** True in processes that never render heightfields (dedicated server, -nullrhi). Never in commandlets, the cooker builds render data */
+	static bool IsRunningWithoutRenderer();
+
+	/**
+	 * Frees the CPU copy of a texture's mips once its heights are decoded, for processes that never render
+	 * the texture (dedicated server, -nullrhi). The texture can't be decoded again afterwards, so the
+	 * decoded data is kept for as long as the world instead of until its last user lets go of it, and
+	 * UHeightfieldTextureSourceSubsystem keeps the unedited heights for later worlds.
+	 * Does nothing once the heights were edited, their unedited version is gone then.
+	 */
+	void ReleaseTextureSource(UTexture2D* Texture);
+
+private:
+	TMap<TObjectKey<UTexture2D>, TWeakPtr<FHeightfieldData, ESPMode::ThreadSafe>> DecodedData;
+
+	/** Data of the textures whose CPU copy was released */
+	TMap<TObjectKey<UTexture2D>, FHeightfieldDataPtr> PinnedData;
+
+	FOnHeightfieldDataShared DataSharedEvent;
+};
+
+/**
+ * Unedited heights of the heightmap textures whose CPU copy was released (see UHeightfieldDataSubsystem::ReleaseTextureSource),
+ * kept compressed for as long as the texture is loaded. Engine-wide, so a later world using the same texture
+ * (seamless travel, map reload) starts from a copy of them instead of decoding the texture.
+ */
+UCLASS()
+class TESTVEHICLEGAME_API UHeightfieldTextureSourceSubsystem : public UEngineSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/** Keeps a copy of a texture's heights, false if they were already edited */
+	bool AddReleasedSource(const UTexture2D* Texture, const FHeightfieldData& Data);
+
+	/** True if the texture's CPU copy was released and its heights are kept here */
+	bool IsReleased(const UTexture2D* Texture) const { return Texture && ReleasedSources.Contains(Texture); }
+
+	/** New data with the kept heights of a released texture, null if the texture wasn't released */
+	FHeightfieldDataPtr CopyReleasedSource(const UTexture2D* Texture) const;
+
+	/** The subsystem of the engine, null before the engine is up */
+	static UHeightfieldTextureSourceSubsystem* Get();
+
+private:
+	TMap<TObjectKey<UTexture2D>, FHeightfieldDataPtr> ReleasedSources;
+};
@@ -5,21 +5,48 @@
 #include "Engine/Engine.h"
 #include "Engine/Texture2D.h"
 #include "Engine/World.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerController.h"
 #include "PhysicalMaterials/PhysicalMaterial.h"
 #include "Physics/PhysicsFiltering.h"
 #include "Physics/PhysicsInterfaceCore.h"
 #include "Physics/PhysicsInterfaceScene.h"
 #include "Physics/Experimental/PhysScene_Chaos.h"
 
+#include "Chaos/ChaosArchive.h"
 #include "Chaos/HeightField.h"
 #include "Chaos/ImplicitObjectTransformed.h"
 #include "Chaos/ImplicitObjectUnion.h"
 #include "Chaos/ShapeInstance.h"
 #include "PhysicsProxy/SingleParticlePhysicsProxy.h"
+#include "Async/Async.h"
+#include "Async/ParallelFor.h"
+#include "Serialization/CustomVersion.h"
 
 // Same Z scale as Landscape
 static constexpr float HEIGHTFIELD_ZSCALE = 1.0f / 128.0f;
 
+/** Serialization versions of UHeightfieldMeshCollisionComponent */
+struct FHeightfieldCollisionCustomVersion
+{
+	enum Type
+	{
+		BeforeCustomVersionWasAdded = 0,
+
+		// Cooked packages carry the built Chaos heightfields
+		CookedCollisionData,
+
+		VersionPlusOne,
+		LatestVersion = VersionPlusOne - 1
+	};
+
+	static const FGuid GUID;
+};
+
+const FGuid FHeightfieldCollisionCustomVersion::GUID(0x5C1E8A27, 0x9B3F4D60, 0xA7D2E914, 0x3F6B0C85);
+static FCustomVersionRegistration GRegisterHeightfieldCollisionCustomVersion(
+	FHeightfieldCollisionCustomVersion::GUID, FHeightfieldCollisionCustomVersion::LatestVersion, TEXT("HeightfieldCollisionVer"));
+
 UHeightfieldMeshCollisionComponent::UHeightfieldMeshCollisionComponent(const FObjectInitializer& ObjectInitializer)
 	: Super(ObjectInitializer)
 {
@@ -30,13 +57,105 @@ UHeightfieldMeshCollisionComponent::UHeightfieldMeshCollisionComponent(const FOb
 	// No mobility change allowed for collision components
 	Mobility = EComponentMobility::Static;
 
+	// Ticks only while edits are queued, after gameplay has queued them for the frame
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = false;
+	PrimaryComponentTick.TickGroup = TG_PostUpdateWork;
+
 	// Initialize cached bounds
 	CachedLocalBox.Init();
 }
 
 UHeightfieldMeshCollisionComponent::~UHeightfieldMeshCollisionComponent()
 {
-	// HeightfieldGeometry is ref-counted and will be cleaned up automatically
+	// Tile heightfields are ref-counted and will be cleaned up automatically
+}
+
+static void SerializeCookedCollision(Chaos::FChaosArchive& Ar, FHeightfieldCookedCollision& Cooked)
+{
+	Ar << Cooked.SourceTextureId << Cooked.NumRows << Cooked.NumCols;
+	Ar << Cooked.CollisionTileSize << Cooked.CoarseCollisionStep << Cooked.NumPhysicalMaterials;
+	Ar << Cooked.TileSteps;
+
+	int32 NumTiles = Cooked.TileGeometry.Num();
+	Ar << NumTiles;
+	if (Ar.IsLoading())
+	{
+		Cooked.TileGeometry.SetNum(NumTiles);
+	}
+	for (Chaos::FHeightFieldPtr& Geometry : Cooked.TileGeometry)
+	{
+		Ar << Geometry;
+	}
+}
+
+void UHeightfieldMeshCollisionComponent::Serialize(FArchive& Ar)
+{
+	Super::Serialize(Ar);
+
+	Ar.UsingCustomVersion(FHeightfieldCollisionCustomVersion::GUID);
+	if (Ar.CustomVer(FHeightfieldCollisionCustomVersion::GUID) < FHeightfieldCollisionCustomVersion::CookedCollisionData)
+	{
+		return;
+	}
+
+	// Cooked packages carry the built heightfields, so creating the collision does not
+	// have to gather the heights of every tile and build its heightfield again
+	bool bHasCookedCollision = false;
+	FHeightfieldCookedCollision Cooked;
+
+#if WITH_EDITOR
+	if (Ar.IsCooking())
+	{
+		bHasCookedCollision = BuildCookedCollision(Cooked);
+	}
+#endif
+
+	Ar << bHasCookedCollision;
+	if (!bHasCookedCollision)
+	{
+		return;
+	}
+
+	Chaos::FChaosArchive ChaosAr(Ar);
+	SerializeCookedCollision(ChaosAr, Cooked);
+
+	if (Ar.IsLoading())
+	{
+		CookedCollision = MoveTemp(Cooked);
+	}
+}
+
+void UHeightfieldMeshCollisionComponent::PostLoad()
+{
+	Super::PostLoad();
+
+	// The texture is loaded by now, drop cooked heightfields that no longer match it
+	if (CookedCollision.IsValid() && !IsBuiltWithCurrentSettings(CookedCollision))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("HeightfieldMeshCollision: Cooked collision of %s is out of date, rebuilding"), *GetPathName());
+		CookedCollision = FHeightfieldCookedCollision();
+	}
+}
+
+void UHeightfieldMeshCollisionComponent::CopySettingsTo(FHeightfieldCookedCollision& OutCooked) const
+{
+	OutCooked.SourceTextureId = FHeightfieldData::GetTextureSourceId(HeightmapTexture);
+	OutCooked.CollisionTileSize = CollisionTileSize;
+	OutCooked.CoarseCollisionStep = HasValidCollisionLODSettings() ? CoarseCollisionStep : 0;
+	OutCooked.NumPhysicalMaterials = PhysicalMaterials.Num();
+}
+
+bool UHeightfieldMeshCollisionComponent::IsBuiltWithCurrentSettings(const FHeightfieldCookedCollision& Cooked) const
+{
+	FHeightfieldCookedCollision Current;
+	CopySettingsTo(Current);
+	// Without the texture source there is nothing to compare the cooked id against, the collision is cooked together with the texture then
+	const bool bSameSource = !Current.SourceTextureId.IsValid() || Cooked.SourceTextureId == Current.SourceTextureId;
+	return bSameSource &&
+		Cooked.CollisionTileSize == Current.CollisionTileSize &&
+		Cooked.CoarseCollisionStep == Current.CoarseCollisionStep &&
+		Cooked.NumPhysicalMaterials == Current.NumPhysicalMaterials;
 }
 
 void UHeightfieldMeshCollisionComponent::OnRegister()
@@ -47,6 +166,28 @@ void UHeightfieldMeshCollisionComponent::OnRegister()
 	UpdateCachedBounds();
 }
 
+void UHeightfieldMeshCollisionComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	FlushHeightfieldEdits();
+
+	if (!IsCollisionLODActive())
+	{
+		SetComponentTickEnabled(false);
+		return;
+	}
+
+	CompleteLODBuilds();
+
+	TimeSinceLODUpdate += DeltaTime;
+	if (TimeSinceLODUpdate >= CollisionLODUpdateInterval)
+	{
+		TimeSinceLODUpdate = 0.0f;
+		UpdateCollisionLOD();
+	}
+}
+
 FBoxSphereBounds UHeightfieldMeshCollisionComponent::CalcBounds(const FTransform& LocalToWorld) const
 {
 	if (CachedLocalBox.IsValid)
@@ -80,8 +221,8 @@ FBoxSphereBounds UHeightfieldMeshCollisionComponent::CalcBounds(const FTransform
 
 bool UHeightfieldMeshCollisionComponent::ShouldCreatePhysicsState() const
 {
-	// Only create physics if we have a valid texture
-	if (!HeightmapTexture || !HeightmapTexture->GetPlatformData())
+	// Only create physics if we have heights or a valid texture
+	if (!SourceHeightData.IsValid() && (!HeightmapTexture || !HeightmapTexture->GetPlatformData()))
 	{
 		return false;
 	}
@@ -95,7 +236,7 @@ void UHeightfieldMeshCollisionComponent::OnCreatePhysicsState()
 	// go directly to USceneComponent
 	USceneComponent::OnCreatePhysicsState();
 
-	if (!BodyInstance.IsValidBodyInstance())
+	if (CollisionTiles.Num() == 0)
 	{
 		CreateCollisionObject();
 	}
@@ -118,7 +259,10 @@ void UHeightfieldMeshCollisionComponent::PostEditChangeProperty(FPropertyChanged
 	// Rebuild collision when relevant properties change
 	if (PropertyName == GET_MEMBER_NAME_CHECKED(UHeightfieldMeshCollisionComponent, HeightmapTexture) ||
 		PropertyName == GET_MEMBER_NAME_CHECKED(UHeightfieldMeshCollisionComponent, PhysicalMaterials) ||
-		PropertyName == GET_MEMBER_NAME_CHECKED(UHeightfieldMeshCollisionComponent, HeightfieldScale))
+		PropertyName == GET_MEMBER_NAME_CHECKED(UHeightfieldMeshCollisionComponent, HeightfieldScale) ||
+		PropertyName == GET_MEMBER_NAME_CHECKED(UHeightfieldMeshCollisionComponent, CollisionTileSize) ||
+		PropertyName == GET_MEMBER_NAME_CHECKED(UHeightfieldMeshCollisionComponent, bCollisionLOD) ||
+		PropertyName == GET_MEMBER_NAME_CHECKED(UHeightfieldMeshCollisionComponent, CoarseCollisionStep))
 	{
 		RebuildCollision();
 	}
@@ -147,101 +291,292 @@ void UHeightfieldMeshCollisionComponent::SetHeightmapTexture(UTexture2D* NewText
 	}
 }
 
-bool UHeightfieldMeshCollisionComponent::ExtractHeightData(
-	TArray<uint16>& OutHeights,
-	TArray<uint8>& OutMaterialIndices,
-	int32& OutNumRows,
-	int32& OutNumCols) const
+void UHeightfieldMeshCollisionComponent::SetHeightData(const FHeightfieldDataPtr& NewHeightData)
 {
-	if (!HeightmapTexture)
+	if (SourceHeightData != NewHeightData)
 	{
-		UE_LOG(LogTemp, Warning, TEXT("HeightfieldMeshCollision: No heightmap texture assigned"));
-		return false;
+		SourceHeightData = NewHeightData;
+		RebuildCollision();
 	}
+}
 
-	const FTexturePlatformData* PlatformData = HeightmapTexture->GetPlatformData();
-	if (!PlatformData || PlatformData->Mips.Num() == 0)
+bool UHeightfieldMeshCollisionComponent::EnsureHeightData()
+{
+	if (HeightData.IsValid())
 	{
-		UE_LOG(LogTemp, Warning, TEXT("HeightfieldMeshCollision: Texture has no platform data"));
-		return false;
+		return true;
 	}
 
-	// Verify format
-	if (PlatformData->PixelFormat != PF_B8G8R8A8)
+	FHeightfieldDataPtr Data = SourceHeightData;
+	if (!Data.IsValid())
 	{
-		UE_LOG(LogTemp, Error, TEXT("HeightfieldMeshCollision: Texture must be BGRA8 format (got %d). Set CompressionSettings=VectorDisplacementmap or UserInterface2D, and SRGB=false."),
-			static_cast<int32>(PlatformData->PixelFormat));
-		return false;
+		if (!HeightmapTexture)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("HeightfieldMeshCollision: No heightmap texture assigned"));
+			return false;
+		}
+
+		// Decoded once and shared with a mesh component using the same texture
+		Data = UHeightfieldDataSubsystem::GetHeightfieldData(this, HeightmapTexture);
+		if (!Data.IsValid())
+		{
+			UE_LOG(LogTemp, Warning, TEXT("HeightfieldMeshCollision: Failed to read heights from %s"), *HeightmapTexture->GetName());
+			return false;
+		}
+	}
+
+	// Already bound if the decode was shared, see OnHeightfieldDataShared
+	BindHeightData(Data);
+	return true;
+}
+
+void UHeightfieldMeshCollisionComponent::BindHeightData(const FHeightfieldDataPtr& Data)
+{
+	if (HeightData.IsValid())
+	{
+		return;
+	}
+
+	UHeightfieldDataSubsystem* DataSubsystem = GetWorld() ? GetWorld()->GetSubsystem<UHeightfieldDataSubsystem>() : nullptr;
+	if (DataSubsystem && HeightDataSharedHandle.IsValid())
+	{
+		DataSubsystem->OnHeightfieldDataShared().Remove(HeightDataSharedHandle);
 	}
+	HeightDataSharedHandle.Reset();
+
+	HeightData = Data;
 
-	const FTexture2DMipMap& Mip0 = PlatformData->Mips[0];
-	OutNumCols = Mip0.SizeX;  // Width = Columns (X direction)
-	OutNumRows = Mip0.SizeY;  // Height = Rows (Y direction)
+	// Follow edits made through the shared data, by this component or any other
+	HeightDataChangedHandle = HeightData->OnRegionChanged().AddUObject(this, &UHeightfieldMeshCollisionComponent::OnHeightDataChanged);
+
+	// Heights are known now, tighten the bounds to them
+	UpdateCachedBounds();
 
-	const int32 NumVertices = OutNumRows * OutNumCols;
-	const int32 NumCells = (OutNumRows - 1) * (OutNumCols - 1);
+	// Nothing renders the heightmap without a renderer (dedicated server, -nullrhi), the decoded heights are all that's needed of it
+	if (DataSubsystem && UHeightfieldDataSubsystem::IsRunningWithoutRenderer() && !SourceHeightData.IsValid())
+	{
+		DataSubsystem->ReleaseTextureSource(HeightmapTexture);
+	}
+}
 
-	OutHeights.SetNumUninitialized(NumVertices);
-	OutMaterialIndices.SetNumUninitialized(NumCells);
+void UHeightfieldMeshCollisionComponent::OnHeightfieldDataShared(const UTexture2D* Texture, const FHeightfieldDataPtr& Data)
+{
+	if (Texture == HeightmapTexture && !SourceHeightData.IsValid())
+	{
+		BindHeightData(Data);
+	}
+}
 
-	// Lock texture data for reading
-	const uint8* PixelData = static_cast<const uint8*>(Mip0.BulkData.LockReadOnly());
-	if (!PixelData)
+/** Size of mip 0 of a heightmap, the size its decoded heights will have. False if the texture has no platform data */
+static bool GetHeightmapSize(const UTexture2D* Texture, int32& OutNumRows, int32& OutNumCols)
+{
+	const FTexturePlatformData* PlatformData = Texture ? Texture->GetPlatformData() : nullptr;
+	if (!PlatformData || PlatformData->Mips.Num() == 0)
 	{
-		UE_LOG(LogTemp, Error, TEXT("HeightfieldMeshCollision: Failed to lock texture mip data"));
 		return false;
 	}
 
-	// Extract heights from B+G channels
-	// BGRA8 layout: B=0, G=1, R=2, A=3 per pixel
-	for (int32 i = 0; i < NumVertices; ++i)
+	OutNumCols = PlatformData->Mips[0].SizeX;  // Width = Columns (X direction)
+	OutNumRows = PlatformData->Mips[0].SizeY;  // Height = Rows (Y direction)
+	return true;
+}
+
+/**
+ * Heights of the samples of a region (clipped to the tile) that lie on the tile's Step grid, and the
+ * rectangle they form in the tile's own samples. False if no sample of the grid is inside the region.
+ */
+static bool GatherTileRegionHeights(const FHeightfieldData& Data, const FIntRect& TileSamples, int32 Step,
+	const FIntRect& Region, TArray<uint16>& OutHeights, FIntRect& OutTileRegion)
+{
+	OutTileRegion.Min.X = FMath::DivideAndRoundUp(Region.Min.X - TileSamples.Min.X, Step);
+	OutTileRegion.Min.Y = FMath::DivideAndRoundUp(Region.Min.Y - TileSamples.Min.Y, Step);
+	OutTileRegion.Max.X = (Region.Max.X - 1 - TileSamples.Min.X) / Step + 1;
+	OutTileRegion.Max.Y = (Region.Max.Y - 1 - TileSamples.Min.Y) / Step + 1;
+	if (OutTileRegion.Min.X >= OutTileRegion.Max.X || OutTileRegion.Min.Y >= OutTileRegion.Max.Y)
 	{
-		const int32 PixelOffset = i * 4;
-		const uint8 B = PixelData[PixelOffset + 0];  // High byte of height
-		const uint8 G = PixelData[PixelOffset + 1];  // Low byte of height
+		return false;
+	}
 
-		OutHeights[i] = (static_cast<uint16>(B) << 8) | static_cast<uint16>(G);
+	OutHeights.SetNumUninitialized(OutTileRegion.Area(), EAllowShrinking::No);
+	if (Step == 1)
+	{
+		Data.CopyHeights(TileSamples.Min.Y + OutTileRegion.Min.Y, TileSamples.Min.X + OutTileRegion.Min.X,
+			OutTileRegion.Height(), OutTileRegion.Width(), OutHeights);
+		return true;
 	}
 
-	// Extract material indices from R channel (per cell, not per vertex)
-	// Cell [row, col] uses the pixel at vertex [row, col] for material
-	const int32 NumMaterials = PhysicalMaterials.Num();
-	for (int32 Row = 0; Row < OutNumRows - 1; ++Row)
+	int32 Index = 0;
+	for (int32 Y = OutTileRegion.Min.Y; Y < OutTileRegion.Max.Y; ++Y)
 	{
-		for (int32 Col = 0; Col < OutNumCols - 1; ++Col)
+		for (int32 X = OutTileRegion.Min.X; X < OutTileRegion.Max.X; ++X)
 		{
-			const int32 VertexIndex = Row * OutNumCols + Col;
-			const int32 CellIndex = Row * (OutNumCols - 1) + Col;
-			const int32 PixelOffset = VertexIndex * 4;
+			OutHeights[Index++] = Data.GetHeightAt(TileSamples.Min.X + X * Step, TileSamples.Min.Y + Y * Step);
+		}
+	}
+	return true;
+}
 
-			uint8 MaterialIndex = PixelData[PixelOffset + 2];  // R channel
+/** Builds the Chaos heightfield of a tile from every Step-th sample, at unit scale. Safe to call from any thread */
+static Chaos::FHeightFieldPtr BuildTileHeightField(const FHeightfieldData& Data, const FIntRect& TileSamples, int32 Step, int32 NumPhysicalMaterials)
+{
+	const int32 NumRows = (TileSamples.Height() - 1) / Step + 1;
+	const int32 NumCols = (TileSamples.Width() - 1) / Step + 1;
 
-			// Clamp to valid range, or mark as hole (0xFF) if out of range
-			if (MaterialIndex >= NumMaterials && NumMaterials > 0)
-			{
-				MaterialIndex = 0;  // Default to first material if out of range
-			}
-			else if (NumMaterials == 0)
+	TArray<uint16> Heights;
+	TArray<uint8> MaterialIndices;
+	MaterialIndices.SetNumUninitialized((NumRows - 1) * (NumCols - 1));
+	{
+		FReadScopeLock ReadLock(Data.GetLock());
+
+		FIntRect TileRegion;
+		GatherTileRegionHeights(Data, TileSamples, Step, TileSamples, Heights, TileRegion);
+
+		// Material indices are per cell, not per vertex
+		// Cell [row, col] uses the pixel at vertex [row, col] for material
+		// Indices without a material fall back to the first (or the single default) material
+		uint8 MaterialRemap[256];
+		for (int32 MaterialIndex = 0; MaterialIndex < 256; ++MaterialIndex)
+		{
+			MaterialRemap[MaterialIndex] = MaterialIndex < NumPhysicalMaterials ? static_cast<uint8>(MaterialIndex) : 0;
+		}
+
+		const TArray<uint8>& VertexMaterialIndices = Data.GetMaterialIndices();
+		for (int32 Row = 0; Row < NumRows - 1; ++Row)
+		{
+			const uint8* RowMaterials = &VertexMaterialIndices[(TileSamples.Min.Y + Row * Step) * Data.GetWidth() + TileSamples.Min.X];
+			uint8* RowCells = &MaterialIndices[Row * (NumCols - 1)];
+			for (int32 Col = 0; Col < NumCols - 1; ++Col)
 			{
-				MaterialIndex = 0;  // Single default material
+				RowCells[Col] = MaterialRemap[RowMaterials[Col * Step]];
 			}
+		}
+	}
+
+	return Chaos::FHeightFieldPtr(new Chaos::FHeightField(
+		Heights,
+		MakeArrayView(MaterialIndices),
+		NumRows,
+		NumCols,
+		Chaos::FVec3(1.0)  // Unit scale, we apply transform via SetScale
+	));
+}
 
-			OutMaterialIndices[CellIndex] = MaterialIndex;
+/** Lays out the tiles of a heightfield, a single one covering everything for a TileSize of 0. Returns the number of tiles along X and Y */
+static FIntPoint LayOutCollisionTiles(int32 NumRows, int32 NumCols, int32 TileSize, TArray<FHeightfieldCollisionTile>& OutTiles)
+{
+	const int32 TileCells = TileSize > 0 ? TileSize : FMath::Max(NumRows, NumCols);
+	const FIntPoint NumTiles(FMath::DivideAndRoundUp(NumCols - 1, TileCells), FMath::DivideAndRoundUp(NumRows - 1, TileCells));
+	OutTiles.SetNum(NumTiles.X * NumTiles.Y);
+	for (int32 TileY = 0; TileY < NumTiles.Y; ++TileY)
+	{
+		for (int32 TileX = 0; TileX < NumTiles.X; ++TileX)
+		{
+			FHeightfieldCollisionTile& Tile = OutTiles[TileY * NumTiles.X + TileX];
+			Tile.StartRow = TileY * TileCells;
+			Tile.StartCol = TileX * TileCells;
+			Tile.NumRows = FMath::Min(TileCells, NumRows - 1 - Tile.StartRow) + 1;
+			Tile.NumCols = FMath::Min(TileCells, NumCols - 1 - Tile.StartCol) + 1;
 		}
 	}
+	return NumTiles;
+}
+
+#if WITH_EDITOR
+bool UHeightfieldMeshCollisionComponent::BuildCookedCollision(FHeightfieldCookedCollision& OutCooked) const
+{
+	if (!HeightmapTexture)
+	{
+		return false;
+	}
+
+	// No world while cooking, the heights are decoded just for the build
+	const FHeightfieldDataPtr Data = FHeightfieldData::CreateFromTexture(HeightmapTexture);
+	if (!Data.IsValid())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("HeightfieldMeshCollision: Failed to read heights from %s, %s is cooked without collision"),
+			*HeightmapTexture->GetName(), *GetPathName());
+		return false;
+	}
 
-	Mip0.BulkData.Unlock();
+	CopySettingsTo(OutCooked);
+	OutCooked.NumRows = Data->GetHeight();
+	OutCooked.NumCols = Data->GetWidth();
+
+	TArray<FHeightfieldCollisionTile> Tiles;
+	LayOutCollisionTiles(OutCooked.NumRows, OutCooked.NumCols, CollisionTileSize, Tiles);
+
+	// Without sources, every tile that can be coarse starts coarse
+	OutCooked.TileSteps.SetNum(Tiles.Num());
+	OutCooked.TileGeometry.SetNum(Tiles.Num());
+	ParallelFor(Tiles.Num(), [&](int32 TileIndex)
+	{
+		const FHeightfieldCollisionTile& Tile = Tiles[TileIndex];
+		const int32 Step = OutCooked.CoarseCollisionStep > 0 && Tile.SupportsStep(OutCooked.CoarseCollisionStep) ? OutCooked.CoarseCollisionStep : 1;
+		OutCooked.TileSteps[TileIndex] = Step;
+		OutCooked.TileGeometry[TileIndex] = BuildTileHeightField(*Data, Tile.GetSamples(), Step, OutCooked.NumPhysicalMaterials);
+	});
 	return true;
 }
+#endif
+
+Chaos::FHeightFieldPtr UHeightfieldMeshCollisionComponent::TakeCookedTileGeometry(int32 TileIndex, int32 Step)
+{
+	if (!CookedCollision.IsValid())
+	{
+		return nullptr;
+	}
+
+	// Edited heights never match the cook again
+	if (HeightData.IsValid() && HeightData->GetRevision() != 0)
+	{
+		CookedCollision = FHeightfieldCookedCollision();
+		return nullptr;
+	}
+
+	if (!CookedCollision.TileGeometry.IsValidIndex(TileIndex) || CookedCollision.TileSteps[TileIndex] != Step)
+	{
+		return nullptr;
+	}
+
+	// Not kept here as well, a tile that comes back to this step later builds it again
+	return MoveTemp(CookedCollision.TileGeometry[TileIndex]);
+}
 
 void UHeightfieldMeshCollisionComponent::CreateCollisionObject()
 {
-	// Extract height data from texture
-	TArray<uint16> Heights;
-	TArray<uint8> MaterialIndices;
-	int32 NumRows, NumCols;
+	// Cooked heightfields only fit the heights of the texture they were built from
+	int32 NumRows = 0;
+	int32 NumCols = 0;
+	if (CookedCollision.IsValid() && (SourceHeightData.IsValid() || !GetHeightmapSize(HeightmapTexture, NumRows, NumCols) ||
+		CookedCollision.NumRows != NumRows || CookedCollision.NumCols != NumCols || !IsBuiltWithCurrentSettings(CookedCollision)))
+	{
+		CookedCollision = FHeightfieldCookedCollision();
+	}
 
-	if (!ExtractHeightData(Heights, MaterialIndices, NumRows, NumCols))
+	if (CookedCollision.IsValid())
+	{
+		// Tiles start from their cooked heightfields, the texture is only decoded once an edit, a query or a tile without one needs it.
+		// Heights another component shares meanwhile are bound right away, so its edits reach the tiles
+		UHeightfieldDataSubsystem* DataSubsystem = GetWorld()->GetSubsystem<UHeightfieldDataSubsystem>();
+		if (const FHeightfieldDataPtr SharedData = DataSubsystem ? DataSubsystem->FindHeightfieldData(HeightmapTexture) : nullptr)
+		{
+			BindHeightData(SharedData);
+		}
+		else if (DataSubsystem)
+		{
+			HeightDataSharedHandle = DataSubsystem->OnHeightfieldDataShared().AddUObject(this, &UHeightfieldMeshCollisionComponent::OnHeightfieldDataShared);
+		}
+		else if (!EnsureHeightData())
+		{
+			return;
+		}
+	}
+	else if (EnsureHeightData())
+	{
+		NumCols = HeightData->GetWidth();
+		NumRows = HeightData->GetHeight();
+	}
+	else
 	{
 		return;
 	}
@@ -250,27 +585,6 @@ void UHeightfieldMeshCollisionComponent::CreateCollisionObject()
 	CachedNumRows = NumRows;
 	CachedNumCols = NumCols;
 
-	// Create the Chaos heightfield
-	HeightfieldGeometry = Chaos::FHeightFieldPtr(new Chaos::FHeightField(
-		MakeArrayView(Heights),
-		MakeArrayView(MaterialIndices),
-		NumRows,
-		NumCols,
-		Chaos::FVec3(1.0)  // Unit scale, we apply transform via SetScale
-	));
-
-	// Calculate final scale
-	FTransform ComponentTransform = GetComponentToWorld();
-	FVector WorldScale = ComponentTransform.GetScale3D();
-
-	FVector FinalScale(
-		HeightfieldScale.X * WorldScale.X,
-		HeightfieldScale.Y * WorldScale.Y,
-		HeightfieldScale.Z * WorldScale.Z * HEIGHTFIELD_ZSCALE
-	);
-
-	HeightfieldGeometry->SetScale(FinalScale * WorldScale.GetSignVector());
-
 	// Register physical materials
 	ChaosMaterialHandles.Reset();
 	if (PhysicalMaterials.Num() > 0)
@@ -294,34 +608,146 @@ void UHeightfieldMeshCollisionComponent::CreateCollisionObject()
 		ChaosMaterialHandles.Add(GEngine->DefaultPhysMaterial->GetPhysicsMaterial());
 	}
 
-	// Create physics actor
+	NumCollisionTiles = LayOutCollisionTiles(NumRows, NumCols, CollisionTileSize, CollisionTiles);
+	if (CookedCollision.IsValid() && CookedCollision.TileGeometry.Num() != CollisionTiles.Num())
+	{
+		CookedCollision = FHeightfieldCookedCollision();
+	}
+
+	// With collision LOD, only tiles near the current sources start at full resolution
+	if (bCollisionLOD && !IsCollisionLODActive())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("HeightfieldMeshCollision: Collision LOD needs a CollisionTileSize that is a multiple of CoarseCollisionStep (%d)"),
+			CoarseCollisionStep);
+	}
+	else if (IsCollisionLODActive())
+	{
+		TArray<FVector2D> SourceLocations;
+		GatherLODSourceLocations(SourceLocations);
+		for (FHeightfieldCollisionTile& Tile : CollisionTiles)
+		{
+			Tile.Step = GetWantedTileStep(Tile, SourceLocations, 1.0);
+		}
+	}
+
+	// Hits on any tile resolve to this component
+	BodyInstance.PhysicsUserData = FPhysicsUserData(&BodyInstance);
+	BodyInstance.OwnerComponent = this;
+
+#if USE_BODYINSTANCE_DEBUG_NAMES
+	const FString DebugName = GetOwner() ?
+		FString::Printf(TEXT("%s:%s"), *GetOwner()->GetName(), *GetName()) : *GetName();
+	BodyInstance.CharDebugName = MakeShareable(new TArray<ANSICHAR>(StringToArray<ANSICHAR>(*DebugName, DebugName.Len() + 1)));
+#endif
+
+	TArray<FPhysicsActorHandle> Actors;
+	Actors.Reserve(CollisionTiles.Num());
+	for (int32 TileIndex = 0; TileIndex < CollisionTiles.Num(); ++TileIndex)
+	{
+		if (!CreateTileActor(TileIndex))
+		{
+			UE_LOG(LogTemp, Error, TEXT("HeightfieldMeshCollision: Failed to create physics actor"));
+			continue;
+		}
+		Actors.Add(CollisionTiles[TileIndex].Actor);
+	}
+
+	if (Actors.Num() == 0)
+	{
+		CollisionTiles.Empty();
+		NumCollisionTiles = FIntPoint::ZeroValue;
+		return;
+	}
+
+	// Without tiling the body instance owns the actor, as for any other primitive
+	if (CollisionTileSize <= 0)
+	{
+		BodyInstance.SetPhysicsActor(CollisionTiles[0].Actor);
+	}
+
+	AddTileActorsToScene(Actors);
+
+	if (FPhysScene* PhysScene = GetWorld()->GetPhysicsScene())
+	{
+		if (BodyInstance.bNotifyRigidBodyCollision)
+		{
+			PhysScene->RegisterForCollisionEvents(this);
+		}
+	}
+
+	if (IsCollisionLODActive())
+	{
+		TimeSinceLODUpdate = 0.0f;
+		SetComponentTickEnabled(true);
+	}
+
+	UE_LOG(LogTemp, Log, TEXT("HeightfieldMeshCollision: Created heightfield %dx%d in %dx%d tiles with scale (%f, %f, %f)"),
+		NumCols, NumRows, NumCollisionTiles.X, NumCollisionTiles.Y,
+		HeightfieldScale.X, HeightfieldScale.Y, HeightfieldScale.Z * HEIGHTFIELD_ZSCALE);
+}
+
+FVector UHeightfieldMeshCollisionComponent::GetTileGeometryScale(const FHeightfieldCollisionTile& Tile) const
+{
+	const FVector WorldScale = GetComponentToWorld().GetScale3D();
+
+	// Coarse tiles span Step samples per cell
+	const FVector FinalScale(
+		HeightfieldScale.X * WorldScale.X * Tile.Step,
+		HeightfieldScale.Y * WorldScale.Y * Tile.Step,
+		HeightfieldScale.Z * WorldScale.Z * HEIGHTFIELD_ZSCALE
+	);
+	return FinalScale * WorldScale.GetSignVector();
+}
+
+bool UHeightfieldMeshCollisionComponent::CreateTileActor(int32 TileIndex, Chaos::FHeightFieldPtr Geometry)
+{
+	FHeightfieldCollisionTile& Tile = CollisionTiles[TileIndex];
+
+	// Chaos keeps its own copy of the heights
+	if (!Geometry)
+	{
+		Geometry = TakeCookedTileGeometry(TileIndex, Tile.Step);
+	}
+	if (!Geometry)
+	{
+		if (!EnsureHeightData())
+		{
+			return false;
+		}
+		Geometry = BuildTileHeightField(*HeightData, Tile.GetSamples(), Tile.Step, PhysicalMaterials.Num());
+	}
+	Tile.Geometry = MoveTemp(Geometry);
+	Tile.Geometry->SetScale(GetTileGeometryScale(Tile));
+
+	const FTransform& ComponentTransform = GetComponentToWorld();
+
+	// Create physics actor at the tile's first sample
 	FActorCreationParams Params;
 	Params.InitialTM = ComponentTransform;
+	Params.InitialTM.SetLocation(ComponentTransform.TransformPosition(
+		FVector(Tile.StartCol * HeightfieldScale.X, Tile.StartRow * HeightfieldScale.Y, 0.0)));
 	Params.InitialTM.SetScale3D(FVector::OneVector);  // Scale is baked into heightfield
 	Params.bQueryOnly = false;
 	Params.bStatic = true;
 	Params.Scene = GetWorld()->GetPhysicsScene();
 
 #if USE_BODYINSTANCE_DEBUG_NAMES
-	const FString DebugName = GetOwner() ?
-		FString::Printf(TEXT("%s:%s"), *GetOwner()->GetName(), *GetName()) : *GetName();
-	BodyInstance.CharDebugName = MakeShareable(new TArray<ANSICHAR>(StringToArray<ANSICHAR>(*DebugName, DebugName.Len() + 1)));
 	Params.DebugName = BodyInstance.CharDebugName.IsValid() ? BodyInstance.CharDebugName->GetData() : nullptr;
 #endif
 
-	FPhysicsActorHandle PhysHandle;
-	FPhysicsInterface::CreateActor(Params, PhysHandle);
+	FPhysicsInterface::CreateActor(Params, Tile.Actor);
 
-	if (!FPhysicsInterface::IsValid(PhysHandle))
+	if (!FPhysicsInterface::IsValid(Tile.Actor))
 	{
-		UE_LOG(LogTemp, Error, TEXT("HeightfieldMeshCollision: Failed to create physics actor"));
-		return;
+		Tile.Actor = nullptr;
+		Tile.Geometry = nullptr;
+		return false;
 	}
 
-	Chaos::FRigidBodyHandle_External& Body_External = PhysHandle->GetGameThreadAPI();
+	Chaos::FRigidBodyHandle_External& Body_External = Tile.Actor->GetGameThreadAPI();
 
 	// Wrap heightfield in transformed implicit object
-	Chaos::FImplicitObjectPtr ImplicitHeightField(HeightfieldGeometry);
+	Chaos::FImplicitObjectPtr ImplicitHeightField(Tile.Geometry);
 	Chaos::FImplicitObjectPtr TransformedHeightField = MakeImplicitObjectPtr<Chaos::TImplicitObjectTransformed<Chaos::FReal, 3>>(
 		ImplicitHeightField,
 		Chaos::FRigidTransform3(FTransform::Identity)
@@ -364,45 +790,265 @@ void UHeightfieldMeshCollisionComponent::CreateCollisionObject()
 	ShapeArray.Emplace(MoveTemp(NewShape));
 	Body_External.MergeShapesArray(MoveTemp(ShapeArray));
 
-	// Setup body instance
-	BodyInstance.PhysicsUserData = FPhysicsUserData(&BodyInstance);
-	BodyInstance.OwnerComponent = this;
-	BodyInstance.SetPhysicsActor(PhysHandle);
 	Body_External.SetUserData(&BodyInstance.PhysicsUserData);
+	return true;
+}
 
-	// Add to physics scene
+void UHeightfieldMeshCollisionComponent::AddTileActorsToScene(TArray<FPhysicsActorHandle>& Actors)
+{
 	FPhysScene* PhysScene = GetWorld()->GetPhysicsScene();
-	if (PhysScene)
+	if (!PhysScene)
+	{
+		return;
+	}
+
+	FPhysicsCommand::ExecuteWrite(PhysScene, [&Actors, PhysScene]()
+	{
+		const bool bImmediateAccelStructureInsertion = true;
+		PhysScene->AddActorsToScene_AssumesLocked(Actors, bImmediateAccelStructureInsertion);
+	});
+
+	for (FPhysicsActorHandle& Actor : Actors)
+	{
+		PhysScene->AddToComponentMaps(this, Actor);
+	}
+}
+
+void UHeightfieldMeshCollisionComponent::ReleaseTileActor(FHeightfieldCollisionTile& Tile)
+{
+	if (FPhysicsInterface::IsValid(Tile.Actor))
 	{
-		FPhysicsCommand::ExecuteWrite(PhysScene, [PhysHandle, PhysScene]()
+		UWorld* World = GetWorld();
+		FPhysScene* PhysScene = World ? World->GetPhysicsScene() : nullptr;
+		if (PhysScene)
 		{
-			TArray<FPhysicsActorHandle> Actors = { PhysHandle };
-			const bool bImmediateAccelStructureInsertion = true;
-			PhysScene->AddActorsToScene_AssumesLocked(Actors, bImmediateAccelStructureInsertion);
-		});
+			PhysScene->RemoveFromComponentMaps(Tile.Actor);
+		}
+
+		FPhysicsInterface::ReleaseActor(Tile.Actor, PhysScene);
+	}
 
-		PhysScene->AddToComponentMaps(this, PhysHandle);
+	Tile.Actor = nullptr;
+	Tile.Geometry = nullptr;
+}
 
-		if (BodyInstance.bNotifyRigidBodyCollision)
+void UHeightfieldMeshCollisionComponent::SetCollisionTileEnabled(int32 TileX, int32 TileY, bool bEnabled)
+{
+	if (CollisionTileSize <= 0 || TileX < 0 || TileY < 0 || TileX >= NumCollisionTiles.X || TileY >= NumCollisionTiles.Y)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("HeightfieldMeshCollision: No collision tile (%d, %d) to %s"),
+			TileX, TileY, bEnabled ? TEXT("enable") : TEXT("disable"));
+		return;
+	}
+
+	const int32 TileIndex = TileY * NumCollisionTiles.X + TileX;
+	FHeightfieldCollisionTile& Tile = CollisionTiles[TileIndex];
+	if (bEnabled && !Tile.Actor)
+	{
+		if (CreateTileActor(TileIndex))
 		{
-			PhysScene->RegisterForCollisionEvents(this);
+			TArray<FPhysicsActorHandle> Actors = { Tile.Actor };
+			AddTileActorsToScene(Actors);
+		}
+	}
+	else if (!bEnabled && Tile.Actor)
+	{
+		ReleaseTileActor(Tile);
+	}
+}
+
+bool UHeightfieldMeshCollisionComponent::IsCollisionTileEnabled(int32 TileX, int32 TileY) const
+{
+	if (TileX < 0 || TileY < 0 || TileX >= NumCollisionTiles.X || TileY >= NumCollisionTiles.Y)
+	{
+		return false;
+	}
+	return CollisionTiles[TileY * NumCollisionTiles.X + TileX].Actor != nullptr;
+}
+
+void UHeightfieldMeshCollisionComponent::AddCollisionLODSource(AActor* Source)
+{
+	if (Source)
+	{
+		ExtraLODSources.AddUnique(Source);
+	}
+}
+
+void UHeightfieldMeshCollisionComponent::RemoveCollisionLODSource(AActor* Source)
+{
+	ExtraLODSources.Remove(Source);
+}
+
+bool UHeightfieldMeshCollisionComponent::IsCollisionLODActive() const
+{
+	return HasValidCollisionLODSettings() && CollisionTiles.Num() > 0;
+}
+
+bool UHeightfieldMeshCollisionComponent::HasValidCollisionLODSettings() const
+{
+	return bCollisionLOD && CollisionTileSize > 0 && CoarseCollisionStep > 1 && CollisionTileSize % CoarseCollisionStep == 0;
+}
+
+void UHeightfieldMeshCollisionComponent::GatherLODSourceLocations(TArray<FVector2D>& OutLocations) const
+{
+	const FTransform& ComponentTransform = GetComponentTransform();
+	auto AddLocation = [&OutLocations, &ComponentTransform](const AActor* Actor)
+	{
+		OutLocations.Add(FVector2D(ComponentTransform.InverseTransformPositionNoScale(Actor->GetActorLocation())));
+	};
+
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		const APlayerController* PlayerController = It->Get();
+		if (const APawn* Pawn = PlayerController ? PlayerController->GetPawn() : nullptr)
+		{
+			AddLocation(Pawn);
 		}
 	}
 
-	UE_LOG(LogTemp, Log, TEXT("HeightfieldMeshCollision: Created heightfield %dx%d with scale (%f, %f, %f)"),
-		NumCols, NumRows, FinalScale.X, FinalScale.Y, FinalScale.Z);
+	for (const TWeakObjectPtr<AActor>& Source : ExtraLODSources)
+	{
+		if (const AActor* SourceActor = Source.Get())
+		{
+			AddLocation(SourceActor);
+		}
+	}
+}
+
+int32 UHeightfieldMeshCollisionComponent::GetWantedTileStep(const FHeightfieldCollisionTile& Tile, const TArray<FVector2D>& SourceLocations, double Hysteresis) const
+{
+	if (!Tile.SupportsStep(CoarseCollisionStep))
+	{
+		return 1;
+	}
+
+	// Sources are unscaled, so the tile spans its samples at the world scale like its heightfield does
+	const FVector WorldScale = GetComponentTransform().GetScale3D().GetAbs();
+	const FVector2D Spacing(HeightfieldScale.X * WorldScale.X, HeightfieldScale.Y * WorldScale.Y);
+	const FBox2D TileArea(
+		FVector2D(Tile.StartCol * Spacing.X, Tile.StartRow * Spacing.Y),
+		FVector2D((Tile.StartCol + Tile.NumCols - 1) * Spacing.X, (Tile.StartRow + Tile.NumRows - 1) * Spacing.Y));
+	const double Radius = FullResolutionRadius * Hysteresis;
+	for (const FVector2D& Location : SourceLocations)
+	{
+		if (TileArea.ComputeSquaredDistanceToPoint(Location) <= Radius * Radius)
+		{
+			return 1;
+		}
+	}
+	return CoarseCollisionStep;
+}
+
+void UHeightfieldMeshCollisionComponent::UpdateCollisionLOD()
+{
+	TArray<FVector2D> SourceLocations;
+	GatherLODSourceLocations(SourceLocations);
+
+	// Full resolution tiles are kept until a source is a bit further away than the radius, so tiles don't flip at its edge
+	constexpr double KeepFullResolutionHysteresis = 1.25;
+
+	const int32 NumPhysicalMaterials = PhysicalMaterials.Num();
+	for (int32 TileIndex = 0; TileIndex < CollisionTiles.Num(); ++TileIndex)
+	{
+		FHeightfieldCollisionTile& Tile = CollisionTiles[TileIndex];
+		if (!Tile.Actor || Tile.PendingBuild.IsValid())
+		{
+			continue;
+		}
+
+		const int32 WantedStep = GetWantedTileStep(Tile, SourceLocations, Tile.Step == 1 ? KeepFullResolutionHysteresis : 1.0);
+		if (WantedStep == Tile.Step)
+		{
+			continue;
+		}
+
+		Tile.PendingStep = WantedStep;
+		Tile.PendingEditCount = Tile.EditCount;
+
+		// Tiles going back to the resolution they were cooked at don't need a build
+		if (Chaos::FHeightFieldPtr CookedGeometry = TakeCookedTileGeometry(TileIndex, WantedStep))
+		{
+			Tile.PendingBuild = UE::Tasks::MakeCompletedTask<Chaos::FHeightFieldPtr>(MoveTemp(CookedGeometry));
+			continue;
+		}
+
+		if (!EnsureHeightData())
+		{
+			continue;
+		}
+
+		Tile.PendingBuild = UE::Tasks::Launch(UE_SOURCE_LOCATION,
+			[Data = HeightData, TileSamples = Tile.GetSamples(), WantedStep, NumPhysicalMaterials]()
+			{
+				return BuildTileHeightField(*Data, TileSamples, WantedStep, NumPhysicalMaterials);
+			});
+	}
+}
+
+void UHeightfieldMeshCollisionComponent::CompleteLODBuilds()
+{
+	TArray<FPhysicsActorHandle> NewActors;
+	TArray<FHeightfieldCollisionTile> OldBodies;
+	for (int32 TileIndex = 0; TileIndex < CollisionTiles.Num(); ++TileIndex)
+	{
+		FHeightfieldCollisionTile& Tile = CollisionTiles[TileIndex];
+		if (!Tile.PendingBuild.IsValid() || !Tile.PendingBuild.IsCompleted())
+		{
+			continue;
+		}
+
+		Chaos::FHeightFieldPtr NewGeometry = Tile.PendingBuild.GetResult();
+		Tile.PendingBuild = UE::Tasks::TTask<Chaos::FHeightFieldPtr>();
+
+		// Built from heights that were edited since, or for a tile that was disabled meanwhile: the next update retries
+		if (!Tile.Actor || Tile.EditCount != Tile.PendingEditCount)
+		{
+			continue;
+		}
+
+		FHeightfieldCollisionTile& OldBody = OldBodies.AddDefaulted_GetRef();
+		OldBody.Actor = Tile.Actor;
+		OldBody.Geometry = Tile.Geometry;
+
+		const int32 OldStep = Tile.Step;
+		Tile.Step = Tile.PendingStep;
+		if (!CreateTileActor(TileIndex, MoveTemp(NewGeometry)))
+		{
+			Tile.Step = OldStep;
+			Tile.Actor = OldBody.Actor;
+			Tile.Geometry = OldBody.Geometry;
+			OldBodies.Pop(EAllowShrinking::No);
+			continue;
+		}
+
+		NewActors.Add(Tile.Actor);
+	}
+
+	// The new bodies go in before the old ones are released, so nothing falls through in between
+	if (NewActors.Num() > 0)
+	{
+		AddTileActorsToScene(NewActors);
+	}
+	for (FHeightfieldCollisionTile& OldBody : OldBodies)
+	{
+		ReleaseTileActor(OldBody);
+	}
 }
 
 void UHeightfieldMeshCollisionComponent::DestroyCollisionObject()
 {
+	// Queued edits still belong in the shared data
+	FlushHeightfieldEdits();
+
+	FPhysicsActorHandle BodyActor = BodyInstance.GetPhysicsActor();
+
 	if (UWorld* World = GetWorld())
 	{
 		if (FPhysScene_Chaos* PhysScene = World->GetPhysicsScene())
 		{
-			FPhysicsActorHandle ActorHandle = BodyInstance.GetPhysicsActor();
-			if (FPhysicsInterface::IsValid(ActorHandle))
+			if (FPhysicsInterface::IsValid(BodyActor))
 			{
-				PhysScene->RemoveFromComponentMaps(ActorHandle);
+				PhysScene->RemoveFromComponentMaps(BodyActor);
 			}
 
 			if (BodyInstance.bNotifyRigidBodyCollision)
@@ -412,53 +1058,129 @@ void UHeightfieldMeshCollisionComponent::DestroyCollisionObject()
 		}
 	}
 
-	HeightfieldGeometry = nullptr;
+	// The body instance releases its own actor, the tile actors are released here
+	for (FHeightfieldCollisionTile& Tile : CollisionTiles)
+	{
+		if (Tile.Actor != BodyActor)
+		{
+			ReleaseTileActor(Tile);
+		}
+	}
+	CollisionTiles.Empty();
+	NumCollisionTiles = FIntPoint::ZeroValue;
+
+	if (HeightData.IsValid())
+	{
+		HeightData->OnRegionChanged().Remove(HeightDataChangedHandle);
+		HeightDataChangedHandle.Reset();
+		HeightData.Reset();
+	}
+
+	if (HeightDataSharedHandle.IsValid())
+	{
+		if (UHeightfieldDataSubsystem* DataSubsystem = GetWorld() ? GetWorld()->GetSubsystem<UHeightfieldDataSubsystem>() : nullptr)
+		{
+			DataSubsystem->OnHeightfieldDataShared().Remove(HeightDataSharedHandle);
+		}
+		HeightDataSharedHandle.Reset();
+	}
+
 	ChaosMaterialHandles.Empty();
 }
 
 void UHeightfieldMeshCollisionComponent::UpdateCachedBounds()
 {
-	if (!HeightmapTexture || !HeightmapTexture->GetPlatformData() || HeightmapTexture->GetPlatformData()->Mips.Num() == 0)
+	// Dimensions of the heights once they are known, else of the texture they will come from
+	const FHeightfieldDataPtr& Data = HeightData.IsValid() ? HeightData : SourceHeightData;
+	int32 Width = 0;
+	int32 Height = 0;
+	if (Data.IsValid())
+	{
+		Width = Data->GetWidth();
+		Height = Data->GetHeight();
+	}
+	else if (!GetHeightmapSize(HeightmapTexture, Height, Width))
 	{
 		CachedLocalBox.Init();
 		return;
 	}
 
-	const FTexturePlatformData* PlatformData = HeightmapTexture->GetPlatformData();
-	const int32 Width = PlatformData->Mips[0].SizeX;
-	const int32 Height = PlatformData->Mips[0].SizeY;
-
 	// Max height range (16-bit centered at 32768)
-	const float MaxHeight = 32767.0f * HeightfieldScale.Z * HEIGHTFIELD_ZSCALE;
+	float MinHeight = -32767.0f * HeightfieldScale.Z * HEIGHTFIELD_ZSCALE;
+	float MaxHeight = 32767.0f * HeightfieldScale.Z * HEIGHTFIELD_ZSCALE;
+
+	// Once the heights are decoded, the root of their min/max pyramid gives the actual range
+	if (Data.IsValid())
+	{
+		const FHeightfieldHeightRange Range = Data->GetHeightRange();
+		MinHeight = (static_cast<float>(Range.Min) - 32768.0f) * HeightfieldScale.Z * HEIGHTFIELD_ZSCALE;
+		MaxHeight = (static_cast<float>(Range.Max) - 32768.0f) * HeightfieldScale.Z * HEIGHTFIELD_ZSCALE;
+	}
 
 	CachedLocalBox = FBox(
-		FVector(0, 0, -MaxHeight),
+		FVector(0, 0, FMath::Min(MinHeight, MaxHeight)),
 		FVector(
 			Width * HeightfieldScale.X,
 			Height * HeightfieldScale.Y,
-			MaxHeight
+			FMath::Max(MinHeight, MaxHeight)
 		)
 	);
 
 	UpdateBounds();
 }
 
-void UHeightfieldMeshCollisionComponent::UpdateHeightfieldRegion(
-	const TArray<float>& Heights,
-	int32 StartRow, int32 StartCol,
-	int32 NumRows, int32 NumCols)
+FHeightfieldQuery UHeightfieldMeshCollisionComponent::GetHeightfieldQuery() const
+{
+	// Collision made of cooked tiles decodes the heights on the first query, they are bound once shared (see OnHeightfieldDataShared)
+	const FHeightfieldDataPtr Data = HeightData.IsValid() || CollisionTiles.Num() == 0 ?
+		HeightData : UHeightfieldDataSubsystem::GetHeightfieldData(this, HeightmapTexture);
+	return FHeightfieldQuery(Data, GetComponentTransform(), HeightfieldScale);
+}
+
+UPhysicalMaterial* UHeightfieldMeshCollisionComponent::GetPhysicalMaterialForIndex(int32 MaterialIndex) const
+{
+	// Same as the Chaos heightfield: indices without a material use the first one, null entries the default material
+	UPhysicalMaterial* PhysMat = PhysicalMaterials.Num() > 0 ?
+		PhysicalMaterials[MaterialIndex < PhysicalMaterials.Num() ? MaterialIndex : 0].Get() : nullptr;
+	return PhysMat ? PhysMat : GEngine->DefaultPhysMaterial.Get();
+}
+
+UPhysicalMaterial* UHeightfieldMeshCollisionComponent::GetSurfaceAt(const FVector2D& WorldXY) const
+{
+	uint8 MaterialIndex;
+	if (!GetHeightfieldQuery().GetMaterialIndexAtWorldXY(WorldXY, MaterialIndex))
+	{
+		return nullptr;
+	}
+	return GetPhysicalMaterialForIndex(MaterialIndex);
+}
+
+void UHeightfieldMeshCollisionComponent::GetSurfacesForWheels(TConstArrayView<FVector2D> WheelWorldXY, TArrayView<UPhysicalMaterial*> OutSurfaces) const
+{
+	check(WheelWorldXY.Num() == OutSurfaces.Num());
+
+	TArray<int32, TInlineAllocator<64>> MaterialIndices;
+	MaterialIndices.SetNumUninitialized(WheelWorldXY.Num());
+	GetHeightfieldQuery().GetMaterialIndicesAtWorldXY(WheelWorldXY, MaterialIndices);
+
+	for (int32 i = 0; i < WheelWorldXY.Num(); ++i)
+	{
+		OutSurfaces[i] = MaterialIndices[i] != INDEX_NONE ? GetPhysicalMaterialForIndex(MaterialIndices[i]) : nullptr;
+	}
+}
+
+bool UHeightfieldMeshCollisionComponent::ConvertHeights(const TArray<float>& Heights, int32 NumRows, int32 NumCols, TArray<uint16>& OutHeights) const
 {
 	if (Heights.Num() != NumRows * NumCols)
 	{
 		UE_LOG(LogTemp, Warning, TEXT("HeightfieldMeshCollision: Heights array size (%d) doesn't match region size (%d x %d = %d)"),
 			Heights.Num(), NumRows, NumCols, NumRows * NumCols);
-		return;
+		return false;
 	}
 
 	// Convert float heights to uint16 format
 	// Float input: -256 to +256 range maps to uint16 0-65535 (centered at 32768)
-	TArray<uint16> Heights16;
-	Heights16.SetNumUninitialized(Heights.Num());
+	OutHeights.SetNumUninitialized(Heights.Num());
 
 	for (int32 i = 0; i < Heights.Num(); ++i)
 	{
@@ -466,27 +1188,32 @@ void UHeightfieldMeshCollisionComponent::UpdateHeightfieldRegion(
 		// Reverse of: LocalHeight = (uint16Height - 32768) * HeightfieldScale.Z * HEIGHTFIELD_ZSCALE
 		const float ScaledHeight = Heights[i] / (HeightfieldScale.Z * HEIGHTFIELD_ZSCALE);
 		const int32 IntHeight = FMath::RoundToInt(ScaledHeight + 32768.0f);
-		Heights16[i] = static_cast<uint16>(FMath::Clamp(IntHeight, 0, 65535));
+		OutHeights[i] = static_cast<uint16>(FMath::Clamp(IntHeight, 0, 65535));
 	}
 
-	UpdateHeightfieldRegionRaw(Heights16, StartRow, StartCol, NumRows, NumCols);
+	return true;
 }
 
-void UHeightfieldMeshCollisionComponent::UpdateHeightfieldRegionRaw(
-	TArrayView<const uint16> Heights,
+void UHeightfieldMeshCollisionComponent::UpdateHeightfieldRegion(
+	const TArray<float>& Heights,
 	int32 StartRow, int32 StartCol,
 	int32 NumRows, int32 NumCols)
 {
-	if (!HeightfieldGeometry)
+	TArray<uint16> Heights16;
+	if (ConvertHeights(Heights, NumRows, NumCols, Heights16))
 	{
-		UE_LOG(LogTemp, Warning, TEXT("HeightfieldMeshCollision: No heightfield geometry to update"));
-		return;
+		UpdateHeightfieldRegionRaw(Heights16, StartRow, StartCol, NumRows, NumCols);
 	}
+}
 
-	FPhysicsActorHandle PhysActorHandle = BodyInstance.GetPhysicsActor();
-	if (!FPhysicsInterface::IsValid(PhysActorHandle))
+void UHeightfieldMeshCollisionComponent::UpdateHeightfieldRegionRaw(
+	TArrayView<const uint16> Heights,
+	int32 StartRow, int32 StartCol,
+	int32 NumRows, int32 NumCols)
+{
+	if (CollisionTiles.Num() == 0 || !EnsureHeightData())
 	{
-		UE_LOG(LogTemp, Warning, TEXT("HeightfieldMeshCollision: No physics actor to update"));
+		UE_LOG(LogTemp, Warning, TEXT("HeightfieldMeshCollision: No heightfield geometry to update"));
 		return;
 	}
 
@@ -500,33 +1227,392 @@ void UHeightfieldMeshCollisionComponent::UpdateHeightfieldRegionRaw(
 		return;
 	}
 
-	FPhysicsCommand::ExecuteWrite(PhysActorHandle, [&](const FPhysicsActorHandle& Actor)
+	// The collision is patched from OnHeightDataChanged, along with every other user of the data
+	HeightData->EditHeights(Heights, StartRow, StartCol, NumRows, NumCols);
+}
+
+void UHeightfieldMeshCollisionComponent::QueueHeightfieldRegion(
+	const TArray<float>& Heights,
+	int32 StartRow, int32 StartCol,
+	int32 NumRows, int32 NumCols)
+{
+	TArray<uint16> Heights16;
+	if (ConvertHeights(Heights, NumRows, NumCols, Heights16))
+	{
+		QueueHeightfieldRegionRaw(Heights16, StartRow, StartCol, NumRows, NumCols);
+	}
+}
+
+void UHeightfieldMeshCollisionComponent::QueueHeightfieldRegionRaw(
+	TArrayView<const uint16> Heights,
+	int32 StartRow, int32 StartCol,
+	int32 NumRows, int32 NumCols)
+{
+	if (CollisionTiles.Num() == 0 || !EnsureHeightData())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("HeightfieldMeshCollision: No heightfield geometry to update"));
+		return;
+	}
+
+	if (Heights.Num() != NumRows * NumCols || !HeightData->IsValidRegion(StartRow, StartCol, NumRows, NumCols))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("HeightfieldMeshCollision: Queued region (%d,%d) + (%d,%d) with %d heights out of bounds (%d,%d)"),
+			StartRow, StartCol, NumRows, NumCols, Heights.Num(), CachedNumRows, CachedNumCols);
+		return;
+	}
+
+	FQueuedEdit& Edit = QueuedEdits.AddDefaulted_GetRef();
+	Edit.Region = FIntRect(StartCol, StartRow, StartCol + NumCols, StartRow + NumRows);
+	Edit.Heights = Heights;
+
+	SetComponentTickEnabled(true);
+}
+
+/** Merges overlapping regions until no two overlap, so every sample is pushed once */
+static void CoalesceRegions(TArray<FIntRect>& Regions)
+{
+	bool bMerged = true;
+	while (bMerged)
+	{
+		bMerged = false;
+		for (int32 i = 0; i < Regions.Num(); ++i)
+		{
+			for (int32 j = Regions.Num() - 1; j > i; --j)
+			{
+				if (Regions[i].Intersect(Regions[j]))
+				{
+					Regions[i].Union(Regions[j]);
+					Regions.RemoveAtSwap(j, EAllowShrinking::No);
+					bMerged = true;
+				}
+			}
+		}
+	}
+}
+
+void UHeightfieldMeshCollisionComponent::FlushHeightfieldEdits()
+{
+	if (QueuedEdits.Num() == 0)
+	{
+		return;
+	}
+
+	TArray<FQueuedEdit> Edits = MoveTemp(QueuedEdits);
+	QueuedEdits.Reset();
+
+	if (!HeightData.IsValid())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("HeightfieldMeshCollision: Dropped %d queued edits, no heightfield data"), Edits.Num());
+		return;
+	}
+
+	// Later edits of the same samples win, as if they had been applied one by one
+	TArray<FIntRect> DirtyRegions;
+	DirtyRegions.Reserve(Edits.Num());
+	for (const FQueuedEdit& Edit : Edits)
+	{
+		if (HeightData->WriteHeights(Edit.Heights, Edit.Region.Min.Y, Edit.Region.Min.X, Edit.Region.Height(), Edit.Region.Width()))
+		{
+			DirtyRegions.Add(Edit.Region);
+		}
+	}
+
+	CoalesceRegions(DirtyRegions);
+
+	// The mesh and any other user of the data update once per merged region
+	{
+		TGuardValue<bool> NotifyGuard(bNotifyingOwnEdits, true);
+		for (const FIntRect& Region : DirtyRegions)
+		{
+			HeightData->NotifyRegionChanged(Region.Min.Y, Region.Min.X, Region.Height(), Region.Width());
+		}
+	}
+
+	// Every tile gets all of its regions in one physics write
+	ApplyRegionsToTiles(DirtyRegions);
+	UpdateCachedBounds();
+}
+
+/** Collision part of an async edit, shared by the build task and the game thread completion */
+struct FHeightfieldAsyncEdit
+{
+	struct FTileEdit
+	{
+		int32 TileIndex = INDEX_NONE;
+
+		/** Heightfield of the tile when the edit was made, the new one only replaces it if the tile still uses it */
+		Chaos::FHeightFieldPtr OldGeometry;
+
+		/** Built by the task, never seen by the physics thread or queries until it is swapped in */
+		Chaos::FHeightFieldPtr NewGeometry;
+
+		FIntRect TileSamples;
+		int32 Step = 1;
+
+		/** Edits of the tile when the build was launched, a later one may have been missed by the build */
+		int32 EditCount = 0;
+	};
+
+	FHeightfieldDataPtr Data;
+	int32 NumPhysicalMaterials = 0;
+	TArray<FTileEdit> TileEdits;
+	TUniqueFunction<void(bool)> OnApplied;
+};
+
+bool UHeightfieldMeshCollisionComponent::UpdateHeightfieldRegionAsync(
+	TArrayView<const uint16> Heights,
+	int32 StartRow, int32 StartCol,
+	int32 NumRows, int32 NumCols,
+	TUniqueFunction<void(bool)>&& OnApplied)
+{
+	FPhysScene* PhysScene = GetWorld() ? GetWorld()->GetPhysicsScene() : nullptr;
+	if (CollisionTiles.Num() == 0 || !PhysScene || !EnsureHeightData())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("HeightfieldMeshCollision: No heightfield geometry to update"));
+		return false;
+	}
+
+	if (!HeightData->WriteHeights(Heights, StartRow, StartCol, NumRows, NumCols))
+	{
+		return false;
+	}
+
+	// The mesh and any other user of the data follow right away
+	{
+		TGuardValue<bool> NotifyGuard(bNotifyingOwnEdits, true);
+		HeightData->NotifyRegionChanged(StartRow, StartCol, NumRows, NumCols);
+	}
+	UpdateCachedBounds();
+
+	TSharedRef<FHeightfieldAsyncEdit, ESPMode::ThreadSafe> Edit = MakeShared<FHeightfieldAsyncEdit, ESPMode::ThreadSafe>();
+	Edit->Data = HeightData;
+	Edit->NumPhysicalMaterials = PhysicalMaterials.Num();
+	Edit->OnApplied = MoveTemp(OnApplied);
+
+	const FIntRect Region(StartCol, StartRow, StartCol + NumCols, StartRow + NumRows);
+	for (int32 TileIndex = 0; TileIndex < CollisionTiles.Num(); ++TileIndex)
+	{
+		FHeightfieldCollisionTile& Tile = CollisionTiles[TileIndex];
+		const FIntRect TileSamples = Tile.GetSamples();
+		if (!Region.Intersect(TileSamples))
+		{
+			continue;
+		}
+
+		++Tile.EditCount;
+		if (Tile.Geometry)
+		{
+			FHeightfieldAsyncEdit::FTileEdit& TileEdit = Edit->TileEdits.AddDefaulted_GetRef();
+			TileEdit.TileIndex = TileIndex;
+			TileEdit.OldGeometry = Tile.Geometry;
+			TileEdit.TileSamples = TileSamples;
+			TileEdit.Step = Tile.Step;
+			TileEdit.EditCount = Tile.EditCount;
+		}
+	}
+
+	++NumPendingAsyncEdits;
+	LaunchAsyncEdit(Edit);
+	return true;
+}
+
+void UHeightfieldMeshCollisionComponent::LaunchAsyncEdit(const TSharedRef<FHeightfieldAsyncEdit, ESPMode::ThreadSafe>& Edit)
+{
+	UE::Tasks::Launch(UE_SOURCE_LOCATION, [Edit, WeakThis = TWeakObjectPtr<UHeightfieldMeshCollisionComponent>(this)]()
+	{
+		// The tiles' heightfields are read by the physics thread and by queries, so the edit goes into new ones.
+		// They are built from the heights as they are now rather than when the edit was made, so a later edit
+		// of the same samples is never undone by this one
+		for (FHeightfieldAsyncEdit::FTileEdit& TileEdit : Edit->TileEdits)
+		{
+			TileEdit.NewGeometry = BuildTileHeightField(*Edit->Data, TileEdit.TileSamples, TileEdit.Step, Edit->NumPhysicalMaterials);
+		}
+
+		AsyncTask(ENamedThreads::GameThread, [Edit, WeakThis]()
+		{
+			if (UHeightfieldMeshCollisionComponent* This = WeakThis.Get())
+			{
+				This->CompleteAsyncEdit(Edit);
+			}
+			else if (Edit->OnApplied)
+			{
+				Edit->OnApplied(false);
+			}
+		});
+	});
+}
+
+void UHeightfieldMeshCollisionComponent::CompleteAsyncEdit(const TSharedRef<FHeightfieldAsyncEdit, ESPMode::ThreadSafe>& Edit)
+{
+	TArray<FHeightfieldAsyncEdit::FTileEdit> MissedTileEdits;
+	for (FHeightfieldAsyncEdit::FTileEdit& TileEdit : Edit->TileEdits)
+	{
+		// Tiles released or rebuilt since the edit already have their new heights, or no body left to update
+		if (!CollisionTiles.IsValidIndex(TileEdit.TileIndex))
+		{
+			continue;
+		}
+
+		FHeightfieldCollisionTile& Tile = CollisionTiles[TileEdit.TileIndex];
+		if (Tile.Geometry != TileEdit.OldGeometry || !FPhysicsInterface::IsValid(Tile.Actor))
+		{
+			continue;
+		}
+
+		// Edited again while the task ran, which patched the old heightfield only: build it once more
+		if (Tile.EditCount != TileEdit.EditCount)
+		{
+			TileEdit.EditCount = Tile.EditCount;
+			MissedTileEdits.Add(MoveTemp(TileEdit));
+			continue;
+		}
+
+		TileEdit.NewGeometry->SetScale(GetTileGeometryScale(Tile));
+		Tile.Geometry = MoveTemp(TileEdit.NewGeometry);
+		FPhysicsCommand::ExecuteWrite(Tile.Actor, [this, &Tile](const FPhysicsActorHandle& Actor)
+		{
+			RefreshTileGeometry_AssumesLocked(Actor, Tile.Geometry);
+		});
+	}
+
+	if (MissedTileEdits.Num() > 0)
+	{
+		Edit->TileEdits = MoveTemp(MissedTileEdits);
+		LaunchAsyncEdit(Edit);
+		return;
+	}
+
+	--NumPendingAsyncEdits;
+	if (Edit->OnApplied)
+	{
+		Edit->OnApplied(true);
+	}
+}
+
+void UHeightfieldMeshCollisionComponent::OnHeightDataChanged(int32 StartRow, int32 StartCol, int32 NumRows, int32 NumCols)
+{
+	// Flushes of the queue and async edits patch the tiles themselves
+	if (bNotifyingOwnEdits)
+	{
+		return;
+	}
+
+	if (CollisionTiles.Num() == 0)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("HeightfieldMeshCollision: No physics actor to update"));
+		return;
+	}
+
+	const FIntRect Region(StartCol, StartRow, StartCol + NumCols, StartRow + NumRows);
+	ApplyRegionsToTiles(MakeArrayView(&Region, 1));
+
+	// Edits can raise or lower the terrain past the current bounds
+	UpdateCachedBounds();
+}
+
+void UHeightfieldMeshCollisionComponent::ApplyRegionsToTiles(TConstArrayView<FIntRect> Regions)
+{
+	// Only the tiles a region overlaps are touched, tiles share their border samples
+	TArray<FIntRect, TInlineAllocator<16>> TileRegions;
+	for (FHeightfieldCollisionTile& Tile : CollisionTiles)
+	{
+		const FIntRect TileSamples = Tile.GetSamples();
+		TileRegions.Reset();
+		for (const FIntRect& Region : Regions)
+		{
+			if (Region.Intersect(TileSamples))
+			{
+				FIntRect Overlap = Region;
+				Overlap.Clip(TileSamples);
+				TileRegions.Add(Overlap);
+			}
+		}
+
+		if (TileRegions.Num() > 0)
+		{
+			++Tile.EditCount;
+			if (Tile.Actor)
+			{
+				UpdateTileHeights(Tile, TileRegions);
+			}
+		}
+	}
+}
+
+void UHeightfieldMeshCollisionComponent::UpdateTileHeights(FHeightfieldCollisionTile& Tile, TConstArrayView<FIntRect> Regions)
+{
+	if (!Tile.Geometry || !FPhysicsInterface::IsValid(Tile.Actor))
+	{
+		return;
+	}
+
+	// Chaos takes each region as its own row-major array, in the tile's samples
+	TArray<TArray<uint16>, TInlineAllocator<4>> RegionHeights;
+	TArray<FIntRect, TInlineAllocator<4>> TileRegions;
+	for (const FIntRect& Region : Regions)
+	{
+		TArray<uint16> Heights;
+		FIntRect TileRegion;
+		if (GatherTileRegionHeights(*HeightData, Tile.GetSamples(), Tile.Step, Region, Heights, TileRegion))
+		{
+			RegionHeights.Add(MoveTemp(Heights));
+			TileRegions.Add(TileRegion);
+		}
+	}
+
+	// Edits between the samples of a coarse tile don't reach it
+	if (TileRegions.Num() == 0)
+	{
+		return;
+	}
+
+	FPhysicsCommand::ExecuteWrite(Tile.Actor, [&](const FPhysicsActorHandle& Actor)
 	{
 		// Update the heightfield data
-		HeightfieldGeometry->EditHeights(Heights, StartRow, StartCol, NumRows, NumCols);
+		for (int32 RegionIndex = 0; RegionIndex < TileRegions.Num(); ++RegionIndex)
+		{
+			const FIntRect& TileRegion = TileRegions[RegionIndex];
+			Tile.Geometry->EditHeights(RegionHeights[RegionIndex], TileRegion.Min.Y, TileRegion.Min.X, TileRegion.Height(), TileRegion.Width());
+		}
+
+		RefreshTileGeometry_AssumesLocked(Actor);
+	});
+}
 
-		// Rebuild geometry wrapper to update local bounds
-		Chaos::FRigidBodyHandle_External& Body_External = Actor->GetGameThreadAPI();
-		const Chaos::FImplicitObject* CurrentGeom = Body_External.GetGeometry();
+void UHeightfieldMeshCollisionComponent::RefreshTileGeometry_AssumesLocked(const FPhysicsActorHandle& Actor, const Chaos::FHeightFieldPtr& NewHeightField)
+{
+	// Rebuild geometry wrapper to update local bounds
+	Chaos::FRigidBodyHandle_External& Body_External = Actor->GetGameThreadAPI();
+	const Chaos::FImplicitObject* CurrentGeom = Body_External.GetGeometry();
 
-		if (CurrentGeom)
+	if (CurrentGeom)
+	{
+		// Get the transformed heightfield and recreate it to update bounds
+		if (const auto* TransformedHF = CurrentGeom->template GetObject<Chaos::TImplicitObjectTransformed<Chaos::FReal, 3>>())
 		{
-			// Get the transformed heightfield and recreate it to update bounds
-			if (const auto* TransformedHF = CurrentGeom->template GetObject<Chaos::TImplicitObjectTransformed<Chaos::FReal, 3>>())
+			Chaos::FImplicitObjectPtr NewGeom;
+			if (NewHeightField)
 			{
-				Chaos::FImplicitObjectPtr NewGeom = MakeImplicitObjectPtr<Chaos::TImplicitObjectTransformed<Chaos::FReal, 3>>(
+				NewGeom = MakeImplicitObjectPtr<Chaos::TImplicitObjectTransformed<Chaos::FReal, 3>>(
+					Chaos::FImplicitObjectPtr(NewHeightField),
+					TransformedHF->GetTransform()
+				);
+			}
+			else
+			{
+				NewGeom = MakeImplicitObjectPtr<Chaos::TImplicitObjectTransformed<Chaos::FReal, 3>>(
 					TransformedHF->GetGeometry(),
 					TransformedHF->GetTransform()
 				);
-				Body_External.SetGeometry(NewGeom);
 			}
+			Body_External.SetGeometry(NewGeom);
 		}
+	}
 
-		// Update acceleration structure
-		FPhysScene* PhysScene = GetWorld()->GetPhysicsScene();
-		if (PhysScene)
-		{
-			PhysScene->UpdateActorInAccelerationStructure(Actor);
-		}
-	});
+	// Update acceleration structure
+	FPhysScene* PhysScene = GetWorld()->GetPhysicsScene();
+	if (PhysScene)
+	{
+		PhysScene->UpdateActorInAccelerationStructure(Actor);
+	}
 }
@@ -6,17 +6,71 @@
 #include "Components/PrimitiveComponent.h"
 #include "Chaos/ImplicitFwd.h"
 #include "Chaos/PhysicalMaterials.h"
+#include "Tasks/Task.h"
+#include "HeightfieldData.h"
+#include "HeightfieldQuery.h"
 
 #include "HeightfieldMeshCollisionComponent.generated.h"
 
 class UTexture2D;
 class UPhysicalMaterial;
+struct FHeightfieldAsyncEdit;
 
 namespace Chaos
 {
 	class FHeightField;
 }
 
+/** A rectangle of the heightfield collided against as its own physics body */
+struct FHeightfieldCollisionTile
+{
+	/** First sample of the tile and its sample counts. Neighbouring tiles share their border samples */
+	int32 StartRow = 0;
+	int32 StartCol = 0;
+	int32 NumRows = 0;
+	int32 NumCols = 0;
+
+	/** Every Step-th sample is collided against, 1 at full resolution */
+	int32 Step = 1;
+
+	/** Chaos heightfield of the tile, null while the tile is disabled */
+	Chaos::FHeightFieldPtr Geometry;
+
+	FPhysicsActorHandle Actor = nullptr;
+
+	/** Background build of the heightfield at another resolution, with the step and the EditCount it started at */
+	UE::Tasks::TTask<Chaos::FHeightFieldPtr> PendingBuild;
+	int32 PendingStep = 0;
+	uint32 PendingEditCount = 0;
+
+	/** Incremented by every edit of the tile's samples, so builds that started before an edit are dropped */
+	uint32 EditCount = 0;
+
+	/** Samples of the tile, X = columns, Y = rows, Max exclusive */
+	FIntRect GetSamples() const { return FIntRect(StartCol, StartRow, StartCol + NumCols, StartRow + NumRows); }
+
+	/** True if the tile's cells divide into cells of the given step */
+	bool SupportsStep(int32 InStep) const { return (NumRows - 1) % InStep == 0 && (NumCols - 1) % InStep == 0; }
+};
+
+/** Chaos heightfields of the collision tiles, built when the component is cooked */
+struct FHeightfieldCookedCollision
+{
+	/** Texture content and settings the heightfields were built with, they are only used while all of them still match */
+	FGuid SourceTextureId;
+	int32 NumRows = 0;
+	int32 NumCols = 0;
+	int32 CollisionTileSize = 0;
+	int32 CoarseCollisionStep = 0;
+	int32 NumPhysicalMaterials = 0;
+
+	/** Heightfield of every tile at the step it starts at (coarse with collision LOD), row-major like the tiles. Null once its tile took it */
+	TArray<int32> TileSteps;
+	TArray<Chaos::FHeightFieldPtr> TileGeometry;
+
+	bool IsValid() const { return TileGeometry.Num() > 0; }
+};
+
 /**
  * A component that creates heightfield collision from a BGRA8 texture.
  *
@@ -36,8 +90,14 @@ public:
 	UHeightfieldMeshCollisionComponent(const FObjectInitializer& ObjectInitializer);
 	virtual ~UHeightfieldMeshCollisionComponent();
 
+	//~ Begin UObject Interface
+	virtual void Serialize(FArchive& Ar) override;
+	virtual void PostLoad() override;
+	//~ End UObject Interface
+
 	//~ Begin UActorComponent Interface
 	virtual void OnRegister() override;
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
 	//~ End UActorComponent Interface
 
 	//~ Begin UPrimitiveComponent Interface
@@ -59,6 +119,8 @@ public:
 	/**
 	 * Efficiently updates only a region of the heightfield at runtime.
 	 * Much faster than full rebuild for dynamic terrain deformation.
+	 * The heights are written to the shared heightfield data, so a mesh component
+	 * using the same heightmap is updated as well.
 	 *
 	 * @param Heights - Array of new height values for the region (row-major order)
 	 * @param StartRow - Starting row index (Y)
@@ -74,6 +136,65 @@ public:
 	 */
 	void UpdateHeightfieldRegionRaw(TArrayView<const uint16> Heights, int32 StartRow, int32 StartCol, int32 NumRows, int32 NumCols);
 
+	/**
+	 * Queues an edit instead of applying it right away. All edits queued during a frame are applied
+	 * together at the end of the frame (or by FlushHeightfieldEdits): the heights are written in queue
+	 * order, overlapping regions are merged, and the collision tiles and every other user of the
+	 * heightfield data (the mesh) are updated once per merged region.
+	 */
+	UFUNCTION(BlueprintCallable, Category="Collision")
+	void QueueHeightfieldRegion(const TArray<float>& Heights, int32 StartRow, int32 StartCol, int32 NumRows, int32 NumCols);
+
+	/** C++ version of QueueHeightfieldRegion that takes uint16 heights directly */
+	void QueueHeightfieldRegionRaw(TArrayView<const uint16> Heights, int32 StartRow, int32 StartCol, int32 NumRows, int32 NumCols);
+
+	/** Applies the queued edits now */
+	UFUNCTION(BlueprintCallable, Category="Collision")
+	void FlushHeightfieldEdits();
+
+	/** Number of edits waiting for the next flush */
+	int32 GetNumQueuedEdits() const { return QueuedEdits.Num(); }
+
+	/**
+	 * Edits a region without waiting on the physics solver. The heights are written to the shared data
+	 * (and so to the mesh) right away; new heightfields of the collision tiles are built from the latest
+	 * heights on a worker task and swapped into their bodies on the game thread.
+	 * OnApplied is called on the game thread once the collision has the new heights, with false if the
+	 * edit could not be applied.
+	 *
+	 * @return false if the edit was rejected, OnApplied is not called then
+	 */
+	bool UpdateHeightfieldRegionAsync(TArrayView<const uint16> Heights, int32 StartRow, int32 StartCol, int32 NumRows, int32 NumCols,
+		TUniqueFunction<void(bool)>&& OnApplied = nullptr);
+
+	/** Number of edits enqueued to the physics thread that have not completed yet */
+	int32 GetNumPendingAsyncEdits() const { return NumPendingAsyncEdits; }
+
+	/** Keeps full resolution collision around an actor, e.g. an AI vehicle. Player pawns always get it */
+	UFUNCTION(BlueprintCallable, Category="Collision")
+	void AddCollisionLODSource(AActor* Source);
+
+	UFUNCTION(BlueprintCallable, Category="Collision")
+	void RemoveCollisionLODSource(AActor* Source);
+
+	/**
+	 * CPU ray, sweep and height queries against this heightfield that don't go through the physics scene.
+	 * The returned query can be used from any thread; it is invalid until the collision has been created.
+	 * Collision created from cooked tiles decodes the heights on the first call.
+	 */
+	FHeightfieldQuery GetHeightfieldQuery() const;
+
+	/**
+	 * Physical material of the surface at a world XY location, looked up from the cell's material index
+	 * without a scene query. Uses the same fallbacks as the collision. Null outside the heightfield or
+	 * before the collision has been created.
+	 */
+	UFUNCTION(BlueprintPure, Category="Collision")
+	UPhysicalMaterial* GetSurfaceAt(const FVector2D& WorldXY) const;
+
+	/** GetSurfaceAt for many locations, e.g. the wheels of every vehicle on the terrain, with a single lock of the heights */
+	void GetSurfacesForWheels(TConstArrayView<FVector2D> WheelWorldXY, TArrayView<UPhysicalMaterial*> OutSurfaces) const;
+
 	/** Returns the heightmap texture */
 	UFUNCTION(BlueprintCallable, Category="Heightfield")
 	UTexture2D* GetHeightmapTexture() const { return HeightmapTexture; }
@@ -82,6 +203,28 @@ public:
 	UFUNCTION(BlueprintCallable, Category="Heightfield")
 	void SetHeightmapTexture(UTexture2D* NewTexture);
 
+	/**
+	 * Builds the collision from the given heightfield data instead of the heightmap texture,
+	 * e.g. for a tile of a streamed terrain. Null goes back to the texture.
+	 */
+	void SetHeightData(const FHeightfieldDataPtr& NewHeightData);
+
+	/** Sample spacing (X, Y) and height scale (Z) */
+	const FVector& GetHeightfieldScale() const { return HeightfieldScale; }
+
+	/** Number of collision tiles along X and Y, (1, 1) without tiling. Zero until the collision is created */
+	FIntPoint GetNumCollisionTiles() const { return NumCollisionTiles; }
+
+	/**
+	 * Adds or removes the physics body of one collision tile, e.g. to only collide near the player.
+	 * Only available with CollisionTileSize set; all tiles start enabled.
+	 */
+	UFUNCTION(BlueprintCallable, Category="Collision")
+	void SetCollisionTileEnabled(int32 TileX, int32 TileY, bool bEnabled);
+
+	UFUNCTION(BlueprintPure, Category="Collision")
+	bool IsCollisionTileEnabled(int32 TileX, int32 TileY) const;
+
 protected:
 	/**
 	 * The heightmap texture (BGRA8 format).
@@ -107,6 +250,34 @@ protected:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Heightfield", meta=(ClampMin="0.01"))
 	FVector HeightfieldScale = FVector(100.0f, 100.0f, 100.0f);
 
+	/**
+	 * Cells along each side of a collision tile, 0 for a single heightfield.
+	 * Each tile is its own physics body with tight bounds, so broadphase pairs stay local
+	 * and an edit only touches the tiles it overlaps.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Heightfield", meta=(ClampMin="0"))
+	int32 CollisionTileSize = 0;
+
+	/**
+	 * Collide against every CoarseCollisionStep-th sample, except for the tiles within FullResolutionRadius
+	 * of a player pawn or an added LOD source. Tiles switch resolution from background builds.
+	 * Needs a CollisionTileSize that is a multiple of CoarseCollisionStep; tiles at the far edges that
+	 * don't divide stay at full resolution.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Heightfield|LOD")
+	bool bCollisionLOD = false;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Heightfield|LOD", meta=(ClampMin="2", ClampMax="16", EditCondition="bCollisionLOD"))
+	int32 CoarseCollisionStep = 4;
+
+	/** Distance from a LOD source, in world units, within which tiles collide at full resolution */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Heightfield|LOD", meta=(ClampMin="0.0", EditCondition="bCollisionLOD"))
+	float FullResolutionRadius = 10000.0f;
+
+	/** Seconds between updates of the tile resolutions */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Heightfield|LOD", meta=(ClampMin="0.0", EditCondition="bCollisionLOD"))
+	float CollisionLODUpdateInterval = 0.25f;
+
 	/** Cached local-space bounding box */
 	UPROPERTY(Transient)
 	FBox CachedLocalBox;
@@ -120,31 +291,143 @@ protected:
 
 private:
 	/**
-	 * Extract height and material data from texture.
-	 * @param OutHeights - Output array of 16-bit heights (row-major order)
-	 * @param OutMaterialIndices - Output array of material indices per cell
-	 * @param OutNumRows - Output number of rows (texture height)
-	 * @param OutNumCols - Output number of columns (texture width)
-	 * @return true if extraction succeeded
+	 * Binds the heights set with SetHeightData, else the shared heights of the texture, decoding them if nobody has yet.
+	 * Tiles created from cooked heightfields don't need them until an edit, a query or a tile without one does.
+	 * @return true if the heights are available
 	 */
-	bool ExtractHeightData(
-		TArray<uint16>& OutHeights,
-		TArray<uint8>& OutMaterialIndices,
-		int32& OutNumRows,
-		int32& OutNumCols) const;
+	bool EnsureHeightData();
+
+	/** Makes Data the heights of the collision and follows its edits, whoever makes them */
+	void BindHeightData(const FHeightfieldDataPtr& Data);
+
+	/** Binds the texture's heights as soon as another component decodes them, so their edits reach the cooked tiles */
+	void OnHeightfieldDataShared(const UTexture2D* Texture, const FHeightfieldDataPtr& Data);
 
 	/** Create the Chaos physics objects and add to scene */
 	void CreateCollisionObject();
 
+	/**
+	 * Creates the physics actor of a tile, without adding it to the scene.
+	 * Uses the given heightfield, built at the tile's Step, else the cooked one or a new build.
+	 */
+	bool CreateTileActor(int32 TileIndex, Chaos::FHeightFieldPtr Geometry = nullptr);
+
+	/**
+	 * Hands the cooked heightfield of a tile at the given step over to the tile, which keeps the only reference to it.
+	 * Null if there is none (anymore) or the heights were edited since.
+	 */
+	Chaos::FHeightFieldPtr TakeCookedTileGeometry(int32 TileIndex, int32 Step);
+
+#if WITH_EDITOR
+	/** Builds the heightfields of every tile from the texture, for the cooked package */
+	bool BuildCookedCollision(FHeightfieldCookedCollision& OutCooked) const;
+#endif
+
+	/** Texture content and settings the collision is built with */
+	void CopySettingsTo(FHeightfieldCookedCollision& OutCooked) const;
+
+	/** True if cooked heightfields were built from the current texture content and settings. Cooked builds only compare the settings */
+	bool IsBuiltWithCurrentSettings(const FHeightfieldCookedCollision& Cooked) const;
+
+	/** Adds newly created tile actors to the physics scene */
+	void AddTileActorsToScene(TArray<FPhysicsActorHandle>& Actors);
+
+	/** Removes a tile actor that is not owned by the body instance from the scene and frees it */
+	void ReleaseTileActor(FHeightfieldCollisionTile& Tile);
+
+	/** Pushes edited regions of the shared heights into the tiles they overlap */
+	void ApplyRegionsToTiles(TConstArrayView<FIntRect> Regions);
+
+	/** Pushes edited regions that lie inside a tile into its heightfield, with a single physics write */
+	void UpdateTileHeights(FHeightfieldCollisionTile& Tile, TConstArrayView<FIntRect> Regions);
+
+	/** True if tiles switch between full and coarse resolution */
+	bool IsCollisionLODActive() const;
+
+	/** True if the LOD settings are usable, whether or not the tiles exist yet */
+	bool HasValidCollisionLODSettings() const;
+
+	/** Component space locations (without scale) of the player pawns and the added LOD sources */
+	void GatherLODSourceLocations(TArray<FVector2D>& OutLocations) const;
+
+	/** Resolution a tile should collide at for the given sources; Hysteresis > 1 keeps full resolution tiles a little longer */
+	int32 GetWantedTileStep(const FHeightfieldCollisionTile& Tile, const TArray<FVector2D>& SourceLocations, double Hysteresis) const;
+
+	/** Starts background builds of tiles whose resolution should change */
+	void UpdateCollisionLOD();
+
+	/** Swaps in the tiles whose background builds have finished */
+	void CompleteLODBuilds();
+
+	/** Builds the new heightfields of the tiles an async edit touched on a worker task, completed on the game thread */
+	void LaunchAsyncEdit(const TSharedRef<FHeightfieldAsyncEdit, ESPMode::ThreadSafe>& Edit);
+
+	/** Swaps the heightfields an async edit built into their tiles and reports completion, or builds the ones edited meanwhile again */
+	void CompleteAsyncEdit(const TSharedRef<FHeightfieldAsyncEdit, ESPMode::ThreadSafe>& Edit);
+
+	/** Scale a tile's heightfield is created with, for the component's current transform */
+	FVector GetTileGeometryScale(const FHeightfieldCollisionTile& Tile) const;
+
+	/**
+	 * Re-wraps the geometry of a tile whose heights changed, so its bounds and the acceleration structure follow.
+	 * With NewHeightField, the tile's body switches to it. Needs the write lock.
+	 */
+	void RefreshTileGeometry_AssumesLocked(const FPhysicsActorHandle& Actor, const Chaos::FHeightFieldPtr& NewHeightField = nullptr);
+
+	/** Physical material the collision uses for a material index of the heightfield */
+	UPhysicalMaterial* GetPhysicalMaterialForIndex(int32 MaterialIndex) const;
+
+	/** Converts heights in local units to the uint16 format, false if their number doesn't match the region */
+	bool ConvertHeights(const TArray<float>& Heights, int32 NumRows, int32 NumCols, TArray<uint16>& OutHeights) const;
+
 	/** Clean up existing physics objects */
 	void DestroyCollisionObject();
 
 	/** Calculate local bounds from heightfield data */
 	void UpdateCachedBounds();
 
-	/** The Chaos heightfield geometry (runtime only, not serialized) */
-	Chaos::FHeightFieldPtr HeightfieldGeometry;
+	/** Pushes a region of the shared heights into the Chaos heightfield after it was edited */
+	void OnHeightDataChanged(int32 StartRow, int32 StartCol, int32 NumRows, int32 NumCols);
+
+	/**
+	 * Physics bodies of the heightfield (runtime only, not serialized), row-major.
+	 * A single tile is owned by the body instance; with tiling, the component owns every tile.
+	 */
+	TArray<FHeightfieldCollisionTile> CollisionTiles;
+	FIntPoint NumCollisionTiles = FIntPoint::ZeroValue;
+
+	/** Heightfields loaded from the cooked package, each handed to its tile once, all of them released once the heights are edited */
+	FHeightfieldCookedCollision CookedCollision;
 
 	/** Chaos material handles for physics simulation */
 	TArray<Chaos::FMaterialHandle> ChaosMaterialHandles;
+
+	/** Heights set with SetHeightData, used instead of the texture */
+	FHeightfieldDataPtr SourceHeightData;
+
+	/** An edit waiting for the next flush, Region in samples (X = columns, Y = rows, Max exclusive) */
+	struct FQueuedEdit
+	{
+		FIntRect Region;
+		TArray<uint16> Heights;
+	};
+
+	TArray<FQueuedEdit> QueuedEdits;
+
+	int32 NumPendingAsyncEdits = 0;
+
+	UPROPERTY(Transient)
+	TArray<TWeakObjectPtr<AActor>> ExtraLODSources;
+
+	float TimeSinceLODUpdate = 0.0f;
+
+	/** Set while this component notifies the data's listeners of its own edits, it updates its tiles itself then */
+	bool bNotifyingOwnEdits = false;
+
+	/** Decoded heights the collision is built from, shared with other components using the same heightmap. Null until needed with cooked tiles */
+	FHeightfieldDataPtr HeightData;
+	FDelegateHandle HeightDataChangedHandle;
+
+	/** Set while cooked tiles wait for the heights to be shared, see OnHeightfieldDataShared */
+	FDelegateHandle HeightDataSharedHandle;
 };
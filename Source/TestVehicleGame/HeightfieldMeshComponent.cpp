@@ -5,348 +5,2084 @@
 #include "Materials/MaterialInterface.h"
 #include "PrimitiveSceneProxy.h"
 #include "DynamicMeshBuilder.h"
+#include "LocalVertexFactory.h"
+#include "Rendering/ColorVertexBuffer.h"
 #include "SceneManagement.h"
 #include "Engine/Engine.h"
+#include "Engine/World.h"
 #include "MaterialDomain.h"
 #include "Materials/Material.h"
+#include "RenderingThread.h"
+#include "RHICommandList.h"
+#include "Async/ParallelFor.h"
+#include "Async/Async.h"
+#include "Tasks/Task.h"
+#include "UObject/StrongObjectPtr.h"
+#include "Serialization/CustomVersion.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/ScopeRWLock.h"
 
 // Z scale factor for heightfield (matches landscape and collision component)
 static constexpr float MESH_HEIGHTFIELD_ZSCALE = 1.0f / 128.0f;
 
+/** Serialization versions of UHeightfieldMeshComponent */
+struct FHeightfieldMeshCustomVersion
+{
+	enum Type
+	{
+		BeforeCustomVersionWasAdded = 0,
+
+		// Cooked packages carry the generated mesh
+		CookedMeshData,
+
+		VersionPlusOne,
+		LatestVersion = VersionPlusOne - 1
+	};
+
+	static const FGuid GUID;
+};
+
+const FGuid FHeightfieldMeshCustomVersion::GUID(0xAEB979D3, 0x44D74C1B, 0x8F14C3D8, 0x76958D5B);
+static FCustomVersionRegistration GRegisterHeightfieldMeshCustomVersion(
+	FHeightfieldMeshCustomVersion::GUID, FHeightfieldMeshCustomVersion::LatestVersion, TEXT("HeightfieldMeshVer"));
+
+/** Vertices regenerated by a partial mesh update, sent from the game thread to the scene proxy */
+struct FHeightfieldMeshRegionUpdate
+{
+	/** A contiguous range of vertices in the chunk-major vertex buffer, one per updated chunk */
+	struct FVertexRun
+	{
+		int32 FirstVertex;
+		int32 NumVertices;
+	};
+
+	TArray<FVertexRun> Runs;
+
+	/** New vertex data, one entry per vertex in Runs order */
+	TArray<FVector3f> Positions;
+	TArray<FVector3f> Normals;
+
+	/** Chunks whose bounds changed, with their new local bounds */
+	TArray<TPair<int32, FBox>> ChunkBounds;
+};
+
+/** A background mesh build, shared between the build task and the component that launched it */
+struct FHeightfieldMeshAsyncBuild
+{
+	FHeightfieldMeshGeometry Geometry;
+	FHeightfieldMeshRenderDataPtr RenderData;
+
+	/** Heightmap read by the task, released on the game thread once the task is done */
+	TStrongObjectPtr<UTexture2D> Texture;
+
+	/** Decoded by the task when no other component had decoded the heightmap yet */
+	bool bDecodedHeightData = false;
+
+	/** Revision of the shared heights when the task copied them, the build is stale once they moved past it */
+	uint32 SourceRevision = 0;
+
+	/** Samples of the shared heights edited since the build started (X = columns, Y = rows, Max exclusive) */
+	FIntRect EditedRegion;
+	bool bHasEditedRegion = false;
+	FDelegateHandle EditedHandle;
+
+	int32 NumStaleRestarts = 0;
+
+	UE::Tasks::FTask Task;
+};
+
+/** Packs the tangent frame of a heightfield vertex: tangent along +X, normal from the heightmap */
+static void PackTangentBasis(const FVector3f& Normal, FPackedNormal* OutTangentBasis)
+{
+	OutTangentBasis[0] = FPackedNormal(FVector3f(1.0f, 0.0f, 0.0f));
+	OutTangentBasis[1] = FPackedNormal(FVector4f(Normal, 1.0f));
+}
+
+/** Writes a partial update into render data that no proxy has uploaded yet */
+static void ApplyRegionUpdate(const FHeightfieldMeshRegionUpdate& Update, FHeightfieldMeshRenderData& RenderData)
+{
+	int32 SourceIndex = 0;
+	for (const FHeightfieldMeshRegionUpdate::FVertexRun& Run : Update.Runs)
+	{
+		for (int32 VertexIndex = Run.FirstVertex; VertexIndex < Run.FirstVertex + Run.NumVertices; ++VertexIndex, ++SourceIndex)
+		{
+			RenderData.Positions[VertexIndex] = Update.Positions[SourceIndex];
+			PackTangentBasis(Update.Normals[SourceIndex], &RenderData.TangentBasis[VertexIndex * 2]);
+		}
+	}
+}
+
+/**
+ * Vertex buffer holding one stream of FHeightfieldMeshRenderData.
+ * Uploads straight from the render data without an intermediate copy,
+ * and creates an SRV for manual vertex fetch.
+ */
+class FHeightfieldMeshStreamBuffer final : public FVertexBuffer
+{
+public:
+	void SetSource(const void* InData, uint32 InStride, uint32 InNumVertices, EPixelFormat InSRVFormat)
+	{
+		SourceData = InData;
+		Stride = InStride;
+		NumVertices = InNumVertices;
+		SRVFormat = InSRVFormat;
+	}
+
+	virtual void InitRHI(FRHICommandListBase& RHICmdList) override
+	{
+		const uint32 Size = Stride * NumVertices;
+		FRHIResourceCreateInfo CreateInfo(TEXT("HeightfieldMeshStream"));
+		VertexBufferRHI = RHICmdList.CreateVertexBuffer(Size, BUF_Static | BUF_ShaderResource, CreateInfo);
+
+		// The source is released right after the first upload, a later re-init
+		// (RHI reset, feature level switch) has nothing left to upload
+		if (SourceData)
+		{
+			void* Data = RHICmdList.LockBuffer(VertexBufferRHI, 0, Size, RLM_WriteOnly);
+			FMemory::Memcpy(Data, SourceData, Size);
+			RHICmdList.UnlockBuffer(VertexBufferRHI);
+			SourceData = nullptr;
+		}
+		else if (OnSourceMissing)
+		{
+			OnSourceMissing();
+		}
+
+		if (RHISupportsManualVertexFetch(GMaxRHIShaderPlatform))
+		{
+			SRV = RHICmdList.CreateShaderResourceView(VertexBufferRHI,
+				FRHIViewDesc::CreateBufferSRV().SetType(FRHIViewDesc::EBufferType::Typed).SetFormat(SRVFormat));
+		}
+	}
+
+	virtual void ReleaseRHI() override
+	{
+		SRV.SafeRelease();
+		FVertexBuffer::ReleaseRHI();
+	}
+
+	/** Overwrites NumToWrite vertices starting at FirstVertex */
+	void* LockVertices(FRHICommandListBase& RHICmdList, uint32 FirstVertex, uint32 NumToWrite)
+	{
+		return RHICmdList.LockBuffer(VertexBufferRHI, FirstVertex * Stride, NumToWrite * Stride, RLM_WriteOnly);
+	}
+
+	void UnlockVertices(FRHICommandListBase& RHICmdList)
+	{
+		RHICmdList.UnlockBuffer(VertexBufferRHI);
+	}
+
+	FShaderResourceViewRHIRef SRV;
+
+	/** Called from InitRHI when the source was already released */
+	TFunction<void()> OnSourceMissing;
+
+private:
+	const void* SourceData = nullptr;
+	uint32 Stride = 0;
+	uint32 NumVertices = 0;
+	EPixelFormat SRVFormat = PF_Unknown;
+};
+
+/** 16 or 32-bit index buffer uploaded straight from FHeightfieldMeshRenderData */
+class FHeightfieldMeshIndexBuffer final : public FIndexBuffer
+{
+public:
+	void SetSource(const void* InData, uint32 InStride, int32 InNumIndices)
+	{
+		SourceData = InData;
+		Stride = InStride;
+		NumIndices = InNumIndices;
+	}
+
+	virtual void InitRHI(FRHICommandListBase& RHICmdList) override
+	{
+		const uint32 Size = NumIndices * Stride;
+		FRHIResourceCreateInfo CreateInfo(TEXT("HeightfieldMeshIndices"));
+		IndexBufferRHI = RHICmdList.CreateIndexBuffer(Stride, Size, BUF_Static, CreateInfo);
+
+		if (SourceData)
+		{
+			void* Data = RHICmdList.LockBuffer(IndexBufferRHI, 0, Size, RLM_WriteOnly);
+			FMemory::Memcpy(Data, SourceData, Size);
+			RHICmdList.UnlockBuffer(IndexBufferRHI);
+			SourceData = nullptr;
+		}
+		else if (OnSourceMissing)
+		{
+			OnSourceMissing();
+		}
+	}
+
+	/** Called from InitRHI when the source was already released */
+	TFunction<void()> OnSourceMissing;
+
+private:
+	const void* SourceData = nullptr;
+	uint32 Stride = sizeof(uint32);
+	int32 NumIndices = 0;
+};
+
+/** Grid offsets of the vertices used by a chunk detail level along one axis (always includes both ends) */
+static void GetLODVertexOffsets(int32 NumVerts, int32 Step, TArray<int32, TInlineAllocator<257>>& OutOffsets)
+{
+	OutOffsets.Reset();
+	for (int32 Offset = 0; Offset < NumVerts - 1; Offset += Step)
+	{
+		OutOffsets.Add(Offset);
+	}
+	OutOffsets.Add(NumVerts - 1);
+}
+
+/**
+ * Right-triangulated irregular network over a square chunk of 2^k + 1 vertices per side.
+ * Every vertex stores the largest vertical error that leaving it out would cause, including
+ * the errors of the vertices that depend on it, so extracting a mesh for an error bound only
+ * has to split triangles whose hypotenuse midpoint exceeds the bound.
+ */
+class FHeightfieldMeshRTIN
+{
+public:
+	/** True if the chunk is a square of 2^k + 1 vertices per side */
+	static bool SupportsChunk(const FHeightfieldMeshChunk& Chunk)
+	{
+		const int32 TileSize = Chunk.NumVertsX - 1;
+		return Chunk.NumVertsX == Chunk.NumVertsY && TileSize >= 2 && FMath::IsPowerOfTwo(TileSize);
+	}
+
+	FHeightfieldMeshRTIN(const FHeightfieldMeshGeometry& Geometry, const FHeightfieldMeshChunk& Chunk)
+		: GridSize(Chunk.NumVertsX)
+	{
+		check(SupportsChunk(Chunk));
+		const int32 TileSize = GridSize - 1;
+
+		TArray<float> Heights;
+		Heights.SetNumUninitialized(GridSize * GridSize);
+		for (int32 Y = 0; Y < GridSize; ++Y)
+		{
+			for (int32 X = 0; X < GridSize; ++X)
+			{
+				Heights[Y * GridSize + X] = Geometry.GetGridVertexPosition(Chunk.GridX + X, Chunk.GridY + Y).Z;
+			}
+		}
+
+		// Border vertices are always kept, so chunks stay watertight with their neighbours
+		// and match the collision heightfield exactly along their edges
+		Errors.SetNumZeroed(GridSize * GridSize);
+		for (int32 i = 0; i < GridSize; ++i)
+		{
+			Errors[i] = MAX_FLT;
+			Errors[TileSize * GridSize + i] = MAX_FLT;
+			Errors[i * GridSize] = MAX_FLT;
+			Errors[i * GridSize + TileSize] = MAX_FLT;
+		}
+
+		// Visit all triangles of the binary triangle tree from the smallest up. Each one
+		// raises the error of its hypotenuse midpoint, and parents inherit the errors of
+		// their children's midpoints so a kept vertex always keeps its ancestors.
+		const int32 NumTriangles = TileSize * TileSize * 2 - 2;
+		const int32 NumParentTriangles = NumTriangles - TileSize * TileSize;
+		for (int32 i = NumTriangles - 1; i >= 0; --i)
+		{
+			int32 AX, AY, BX, BY, CX, CY;
+			GetTriangle(i + 2, TileSize, AX, AY, BX, BY, CX, CY);
+
+			const int32 MX = (AX + BX) >> 1;
+			const int32 MY = (AY + BY) >> 1;
+			const float Interpolated = 0.5f * (Heights[AY * GridSize + AX] + Heights[BY * GridSize + BX]);
+
+			float& MiddleError = Errors[MY * GridSize + MX];
+			MiddleError = FMath::Max(MiddleError, FMath::Abs(Interpolated - Heights[MY * GridSize + MX]));
+			if (i < NumParentTriangles)
+			{
+				MiddleError = FMath::Max3(MiddleError,
+					Errors[((AY + CY) >> 1) * GridSize + ((AX + CX) >> 1)],
+					Errors[((BY + CY) >> 1) * GridSize + ((BX + CX) >> 1)]);
+			}
+		}
+	}
+
+	/**
+	 * Calls Func(AX, AY, BX, BY, CX, CY) with the chunk-local vertex coordinates of every
+	 * triangle of the mesh for the given error bound. Triangles keep the winding of the uniform grid.
+	 */
+	template<typename FuncType>
+	void ForEachTriangle(float MaxError, FuncType&& Func) const
+	{
+		struct FTriangle
+		{
+			int32 AX, AY, BX, BY, CX, CY;
+		};
+
+		const int32 TileSize = GridSize - 1;
+		TArray<FTriangle, TInlineAllocator<64>> Stack;
+		Stack.Add({ TileSize, TileSize, 0, 0, 0, TileSize });
+		Stack.Add({ 0, 0, TileSize, TileSize, TileSize, 0 });
+		while (Stack.Num() > 0)
+		{
+			const FTriangle Triangle = Stack.Pop(EAllowShrinking::No);
+			const int32 MX = (Triangle.AX + Triangle.BX) >> 1;
+			const int32 MY = (Triangle.AY + Triangle.BY) >> 1;
+			const bool bCanSplit = FMath::Abs(Triangle.AX - Triangle.CX) + FMath::Abs(Triangle.AY - Triangle.CY) > 1;
+
+			if (bCanSplit && Errors[MY * GridSize + MX] > MaxError)
+			{
+				Stack.Add({ Triangle.BX, Triangle.BY, Triangle.CX, Triangle.CY, MX, MY });
+				Stack.Add({ Triangle.CX, Triangle.CY, Triangle.AX, Triangle.AY, MX, MY });
+			}
+			else
+			{
+				Func(Triangle.AX, Triangle.AY, Triangle.BX, Triangle.BY, Triangle.CX, Triangle.CY);
+			}
+		}
+	}
+
+	int32 CountTriangles(float MaxError) const
+	{
+		int32 NumTriangles = 0;
+		ForEachTriangle(MaxError, [&NumTriangles](int32, int32, int32, int32, int32, int32) { ++NumTriangles; });
+		return NumTriangles;
+	}
+
+private:
+	/** Vertex coordinates of a triangle of the binary triangle tree, ids start at 2 for the two root triangles */
+	static void GetTriangle(int32 Id, int32 TileSize, int32& AX, int32& AY, int32& BX, int32& BY, int32& CX, int32& CY)
+	{
+		AX = AY = BX = BY = CX = CY = 0;
+		if (Id & 1)
+		{
+			BX = BY = CX = TileSize;
+		}
+		else
+		{
+			AX = AY = CY = TileSize;
+		}
+
+		// Each further bit picks the left or right half of the current triangle
+		while ((Id >>= 1) > 1)
+		{
+			const int32 MX = (AX + BX) >> 1;
+			const int32 MY = (AY + BY) >> 1;
+			if (Id & 1)
+			{
+				BX = AX;
+				BY = AY;
+				AX = CX;
+				AY = CY;
+			}
+			else
+			{
+				AX = BX;
+				AY = BY;
+				BX = CX;
+				BY = CY;
+			}
+			CX = MX;
+			CY = MY;
+		}
+	}
+
+	int32 GridSize = 0;
+	TArray<float> Errors;
+};
+
+/** Vertical error bound of an adaptive chunk detail level, doubling per level */
+static float GetAdaptiveLODError(float MaxError, int32 LODIndex)
+{
+	return MaxError * (1 << LODIndex);
+}
+
+/** Number of indices WriteChunkLODIndices writes for a chunk detail level */
+static int32 GetChunkLODIndexCount(const FHeightfieldMeshChunk& Chunk, int32 Step, bool bWithSkirts,
+	const FHeightfieldMeshRTIN* AdaptiveSurface = nullptr, float MaxError = 0.0f)
+{
+	// Adaptive surfaces keep their full resolution border, and so do their skirts
+	const int32 SkirtStep = AdaptiveSurface ? 1 : Step;
+	const int32 NumQuadsX = FMath::DivideAndRoundUp(Chunk.NumVertsX - 1, SkirtStep);
+	const int32 NumQuadsY = FMath::DivideAndRoundUp(Chunk.NumVertsY - 1, SkirtStep);
+	const int32 NumSkirtQuads = bWithSkirts ? 2 * (NumQuadsX + NumQuadsY) : 0;
+	const int32 NumSurfaceTriangles = AdaptiveSurface ? AdaptiveSurface->CountTriangles(MaxError) : NumQuadsX * NumQuadsY * 2;
+	return NumSurfaceTriangles * 3 + NumSkirtQuads * 6;
+}
+
+/**
+ * Calls Func(X, Y) for every quad of a NumQuadsX x NumQuadsY grid, either row by row
+ * or along a Z-order curve. The Z-order keeps consecutive quads close together in both
+ * directions, so their shared vertices are still in the post-transform cache.
+ */
+template<typename FuncType>
+static void ForEachQuad(int32 NumQuadsX, int32 NumQuadsY, bool bZOrder, FuncType&& Func)
+{
+	if (!bZOrder)
+	{
+		for (int32 Y = 0; Y < NumQuadsY; ++Y)
+		{
+			for (int32 X = 0; X < NumQuadsX; ++X)
+			{
+				Func(X, Y);
+			}
+		}
+		return;
+	}
+
+	const uint32 Side = FMath::RoundUpToPowerOfTwo(static_cast<uint32>(FMath::Max(NumQuadsX, NumQuadsY)));
+	for (uint32 Code = 0; Code < Side * Side; ++Code)
+	{
+		const int32 X = static_cast<int32>(FMath::ReverseMortonCode2(Code));
+		const int32 Y = static_cast<int32>(FMath::ReverseMortonCode2(Code >> 1));
+		if (X < NumQuadsX && Y < NumQuadsY)
+		{
+			Func(X, Y);
+		}
+	}
+}
+
+/**
+ * Writes the triangles of one detail level of a chunk, optionally with skirts along its four edges.
+ * Indices are relative to the chunk's first vertex, which is drawn as the base vertex index.
+ * With an adaptive surface, its triangles for MaxError replace the uniform grid of the level.
+ */
+template<typename IndexType>
+static void WriteChunkLODIndices(IndexType* OutIndices, const FHeightfieldMeshChunk& Chunk, int32 Step, bool bWithSkirts, bool bZOrder,
+	const FHeightfieldMeshRTIN* AdaptiveSurface = nullptr, float MaxError = 0.0f)
+{
+	using EEdge = FHeightfieldMeshChunk::EEdge;
+
+	TArray<int32, TInlineAllocator<257>> OffsetsX, OffsetsY;
+	GetLODVertexOffsets(Chunk.NumVertsX, AdaptiveSurface ? 1 : Step, OffsetsX);
+	GetLODVertexOffsets(Chunk.NumVertsY, AdaptiveSurface ? 1 : Step, OffsetsY);
+
+	auto GridVertex = [&Chunk](int32 X, int32 Y) -> IndexType
+	{
+		return static_cast<IndexType>(Y * Chunk.NumVertsX + X);
+	};
+
+	auto SkirtVertex = [&Chunk](EEdge Edge, int32 Offset) -> IndexType
+	{
+		return static_cast<IndexType>(Chunk.GetSkirtVertex(Edge, Offset) - Chunk.FirstVertex);
+	};
+
+	auto WriteTriangle = [&OutIndices](IndexType A, IndexType B, IndexType C)
+	{
+		*OutIndices++ = A;
+		*OutIndices++ = B;
+		*OutIndices++ = C;
+	};
+
+	if (AdaptiveSurface)
+	{
+		// The triangle tree is walked depth first, which already keeps neighbouring triangles together
+		AdaptiveSurface->ForEachTriangle(MaxError, [&](int32 AX, int32 AY, int32 BX, int32 BY, int32 CX, int32 CY)
+		{
+			WriteTriangle(GridVertex(AX, AY), GridVertex(BX, BY), GridVertex(CX, CY));
+		});
+	}
+	else
+	{
+		// Surface (two triangles per quad)
+		ForEachQuad(OffsetsX.Num() - 1, OffsetsY.Num() - 1, bZOrder, [&](int32 i, int32 j)
+		{
+			const IndexType TopLeft = GridVertex(OffsetsX[i], OffsetsY[j]);
+			const IndexType TopRight = GridVertex(OffsetsX[i + 1], OffsetsY[j]);
+			const IndexType BottomLeft = GridVertex(OffsetsX[i], OffsetsY[j + 1]);
+			const IndexType BottomRight = GridVertex(OffsetsX[i + 1], OffsetsY[j + 1]);
+
+			WriteTriangle(TopLeft, BottomLeft, TopRight);
+			WriteTriangle(TopRight, BottomLeft, BottomRight);
+		});
+	}
+
+	if (!bWithSkirts)
+	{
+		return;
+	}
+
+	// Skirts hang below each edge segment and face outwards, so the gap to a
+	// coarser or finer neighbour is always covered
+	auto WriteSkirtQuad = [&WriteTriangle](IndexType A, IndexType B, IndexType SkirtA, IndexType SkirtB, bool bFlip)
+	{
+		if (bFlip)
+		{
+			WriteTriangle(A, SkirtA, B);
+			WriteTriangle(B, SkirtA, SkirtB);
+		}
+		else
+		{
+			WriteTriangle(A, B, SkirtA);
+			WriteTriangle(B, SkirtB, SkirtA);
+		}
+	};
+
+	const int32 LastX = Chunk.NumVertsX - 1;
+	const int32 LastY = Chunk.NumVertsY - 1;
+	for (int32 i = 0; i < OffsetsX.Num() - 1; ++i)
+	{
+		const int32 X0 = OffsetsX[i];
+		const int32 X1 = OffsetsX[i + 1];
+		WriteSkirtQuad(GridVertex(X0, 0), GridVertex(X1, 0), SkirtVertex(EEdge::Top, X0), SkirtVertex(EEdge::Top, X1), false);
+		WriteSkirtQuad(GridVertex(X0, LastY), GridVertex(X1, LastY), SkirtVertex(EEdge::Bottom, X0), SkirtVertex(EEdge::Bottom, X1), true);
+	}
+	for (int32 j = 0; j < OffsetsY.Num() - 1; ++j)
+	{
+		const int32 Y0 = OffsetsY[j];
+		const int32 Y1 = OffsetsY[j + 1];
+		WriteSkirtQuad(GridVertex(0, Y0), GridVertex(0, Y1), SkirtVertex(EEdge::Left, Y0), SkirtVertex(EEdge::Left, Y1), true);
+		WriteSkirtQuad(GridVertex(LastX, Y0), GridVertex(LastX, Y1), SkirtVertex(EEdge::Right, Y0), SkirtVertex(EEdge::Right, Y1), false);
+	}
+}
+
+/** Average cache miss ratio (vertices transformed per triangle) of a triangle list on a FIFO post-transform cache */
+static float ComputeACMR(TConstArrayView<uint32> Indices, int32 CacheSize)
+{
+	TArray<uint32> Cache;
+	Cache.Init(MAX_uint32, CacheSize);
+	int32 CacheHead = 0;
+	int32 NumMisses = 0;
+
+	for (const uint32 Index : Indices)
+	{
+		if (!Cache.Contains(Index))
+		{
+			Cache[CacheHead] = Index;
+			CacheHead = (CacheHead + 1) % CacheSize;
+			++NumMisses;
+		}
+	}
+
+	return Indices.Num() > 0 ? static_cast<float>(NumMisses) / (Indices.Num() / 3) : 0.0f;
+}
+
+/** Logs the ACMR of row-major and Z-order triangle orders for full resolution chunks of common sizes */
+static void ReportIndexOrderACMR(const TArray<FString>& Args)
+{
+	const int32 CacheSize = Args.Num() > 0 ? FMath::Max(4, FCString::Atoi(*Args[0])) : 32;
+	const int32 ChunkSizes[] = { 16, 32, 64, 128, 255 };
+
+	UE_LOG(LogTemp, Log, TEXT("HeightfieldMesh: ACMR with a %d vertex FIFO cache (1.0 = every vertex shaded twice, 0.5 = ideal)"), CacheSize);
+	for (const int32 ChunkQuads : ChunkSizes)
+	{
+		FHeightfieldMeshChunk Chunk;
+		Chunk.NumVertsX = ChunkQuads + 1;
+		Chunk.NumVertsY = ChunkQuads + 1;
+
+		TArray<uint32> Indices;
+		Indices.SetNumUninitialized(GetChunkLODIndexCount(Chunk, 1, false));
+
+		WriteChunkLODIndices(Indices.GetData(), Chunk, 1, false, false);
+		const float RowMajorACMR = ComputeACMR(Indices, CacheSize);
+
+		WriteChunkLODIndices(Indices.GetData(), Chunk, 1, false, true);
+		const float ZOrderACMR = ComputeACMR(Indices, CacheSize);
+
+		UE_LOG(LogTemp, Log, TEXT("HeightfieldMesh: %3d x %3d quad chunk: row-major %.3f, Z-order %.3f"),
+			ChunkQuads, ChunkQuads, RowMajorACMR, ZOrderACMR);
+	}
+}
+
+static FAutoConsoleCommand GHeightfieldMeshReportACMRCommand(
+	TEXT("HeightfieldMesh.ReportACMR"),
+	TEXT("Logs the post-transform cache efficiency of the chunk triangle orders. Optional argument: cache size in vertices (default 32)."),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&ReportIndexOrderACMR));
+
+/** Node of the chunk quadtree used for hierarchical culling in the scene proxy */
+struct FHeightfieldMeshQuadtreeNode
+{
+	FBox LocalBounds = FBox(ForceInit);
+	int32 Parent = INDEX_NONE;
+	int32 Children[4] = { INDEX_NONE, INDEX_NONE, INDEX_NONE, INDEX_NONE };
+
+	/** Chunk rendered by this node, leaves only */
+	int32 ChunkIndex = INDEX_NONE;
+};
+
 /** Scene proxy for rendering the heightfield mesh */
 class FHeightfieldMeshSceneProxy final : public FPrimitiveSceneProxy
 {
 public:
-	FHeightfieldMeshSceneProxy(UHeightfieldMeshComponent* Component)
+	FHeightfieldMeshSceneProxy(UHeightfieldMeshComponent* Component, FHeightfieldMeshRenderDataPtr InRenderData)
 		: FPrimitiveSceneProxy(Component)
 		, MaterialRelevance(Component->GetMaterialRelevance(GetScene().GetShaderPlatform()))
 		, VertexFactory(GetScene().GetFeatureLevel(), "FHeightfieldMeshVertexFactory")
 	{
-		// Copy mesh data from component
-		Component->GetMeshData(Vertices, Indices, Normals, UVs);
+		check(InRenderData.IsValid());
+
+		Chunks = Component->Geometry.Chunks;
+		NumVertices = InRenderData->Positions.Num();
+		NumIndices = InRenderData->GetNumIndices();
+		LOD0Distance = FMath::Max(1.0f, Component->LOD0Distance);
+		bCacheDrawCommands = Component->bCacheDrawCommands;
+		for (const FHeightfieldMeshChunk& Chunk : Chunks)
+		{
+			NumLODs = FMath::Max(NumLODs, Chunk.LODs.Num());
+		}
+
+		// Build the chunk quadtree
+		ChunkToNode.SetNumUninitialized(Chunks.Num());
+		if (Chunks.Num() > 0)
+		{
+			Nodes.Reserve(Chunks.Num() * 2);
+			const FHeightfieldMeshGeometry& Geometry = Component->Geometry;
+			BuildQuadtreeNode(0, 0, Geometry.NumChunksX, Geometry.NumChunksY, Geometry.NumChunksX, INDEX_NONE);
+		}
+
+		// Get material
+		Material = Component->GetMaterial(0);
+		if (!Material)
+		{
+			Material = UMaterial::GetDefaultMaterial(MD_Surface);
+		}
+
+		// Buffers re-initialized after the render data is gone can't be refilled, the component builds a new proxy then
+		WeakComponent = Component;
+		PositionBuffer.OnSourceMissing = [this]() { OnRenderDataLost(); };
+		TangentBuffer.OnSourceMissing = [this]() { OnRenderDataLost(); };
+		TexCoordBuffer.OnSourceMissing = [this]() { OnRenderDataLost(); };
+		IndexBuffer.OnSourceMissing = [this]() { OnRenderDataLost(); };
+
+		// Create the GPU buffers straight from the render data, then let it go.
+		// The proxy keeps no CPU copy of the mesh.
+		ENQUEUE_RENDER_COMMAND(InitHeightfieldMeshResources)(
+			[this, RenderData = MoveTemp(InRenderData)](FRHICommandListImmediate& RHICmdList) mutable
+			{
+				PositionBuffer.SetSource(RenderData->Positions.GetData(), sizeof(FVector3f), NumVertices, PF_R32_FLOAT);
+				TangentBuffer.SetSource(RenderData->TangentBasis.GetData(), 2 * sizeof(FPackedNormal), NumVertices, PF_R8G8B8A8_SNORM);
+				const bool bCompactTexCoords = RenderData->UsesCompactVertexFormat();
+				if (bCompactTexCoords)
+				{
+					TexCoordBuffer.SetSource(RenderData->CompactTexCoords.GetData(), sizeof(FHeightfieldCompactTexCoord), NumVertices, PF_G16R16);
+				}
+				else
+				{
+					TexCoordBuffer.SetSource(RenderData->TexCoords.GetData(), sizeof(FVector2f), NumVertices, PF_G32R32F);
+				}
+				if (RenderData->Uses16BitIndices())
+				{
+					IndexBuffer.SetSource(RenderData->Indices16.GetData(), sizeof(uint16), NumIndices);
+				}
+				else
+				{
+					IndexBuffer.SetSource(RenderData->Indices.GetData(), sizeof(uint32), NumIndices);
+				}
+
+				PositionBuffer.InitResource(RHICmdList);
+				TangentBuffer.InitResource(RHICmdList);
+				TexCoordBuffer.InitResource(RHICmdList);
+				IndexBuffer.InitResource(RHICmdList);
+
+				FLocalVertexFactory::FDataType Data;
+				Data.PositionComponent = FVertexStreamComponent(&PositionBuffer, 0, sizeof(FVector3f), VET_Float3);
+				Data.PositionComponentSRV = PositionBuffer.SRV;
+				Data.TangentBasisComponents[0] = FVertexStreamComponent(&TangentBuffer, 0, 2 * sizeof(FPackedNormal), VET_PackedNormal);
+				Data.TangentBasisComponents[1] = FVertexStreamComponent(&TangentBuffer, sizeof(FPackedNormal), 2 * sizeof(FPackedNormal), VET_PackedNormal);
+				Data.TangentsSRV = TangentBuffer.SRV;
+				Data.TextureCoordinates.Add(bCompactTexCoords ?
+					FVertexStreamComponent(&TexCoordBuffer, 0, sizeof(FHeightfieldCompactTexCoord), VET_UShort2N) :
+					FVertexStreamComponent(&TexCoordBuffer, 0, sizeof(FVector2f), VET_Float2));
+				Data.TextureCoordinatesSRV = TexCoordBuffer.SRV;
+				Data.NumTexCoords = 1;
+				Data.LightMapCoordinateIndex = 0;
+
+				// Vertex color is constant white, use the engine's shared null color buffer
+				FColorVertexBuffer::BindDefaultColorVertexBuffer(&VertexFactory, Data, FColorVertexBuffer::NullBindStride::ZeroForDefaultBufferBind);
+
+				VertexFactory.SetData(RHICmdList, Data);
+				VertexFactory.InitResource(RHICmdList);
+
+				RenderData.Reset();
+			});
+	}
+
+	virtual ~FHeightfieldMeshSceneProxy()
+	{
+		PositionBuffer.ReleaseResource();
+		TangentBuffer.ReleaseResource();
+		TexCoordBuffer.ReleaseResource();
+		IndexBuffer.ReleaseResource();
+		VertexFactory.ReleaseResource();
+	}
+
+	/** Stops drawing the buffers, which lost their contents, and has the component create a new proxy. Render thread */
+	void OnRenderDataLost()
+	{
+		if (bLostRenderData)
+		{
+			return;
+		}
+
+		bLostRenderData = true;
+		AsyncTask(ENamedThreads::GameThread, [WeakComponent = WeakComponent]()
+		{
+			if (UHeightfieldMeshComponent* Component = WeakComponent.Get())
+			{
+				Component->MarkRenderStateDirty();
+			}
+		});
+	}
+
+	virtual SIZE_T GetTypeHash() const override
+	{
+		static size_t UniquePointer;
+		return reinterpret_cast<size_t>(&UniquePointer);
+	}
+
+	virtual void DrawStaticElements(FStaticPrimitiveDrawInterface* PDI) override
+	{
+		if (!bCacheDrawCommands || NumVertices == 0 || NumIndices == 0)
+		{
+			return;
+		}
+
+		// Every detail level of every chunk gets cached, GetCustomLOD picks the level for the whole component
+		FMaterialRenderProxy* MaterialProxy = Material->GetRenderProxy();
+		for (int32 LODIndex = 0; LODIndex < NumLODs; ++LODIndex)
+		{
+			for (int32 FirstChunk = 0; FirstChunk < Chunks.Num(); FirstChunk += MaxElementsPerBatch)
+			{
+				FMeshBatch Mesh;
+				Mesh.VertexFactory = &VertexFactory;
+				Mesh.MaterialRenderProxy = MaterialProxy;
+				Mesh.ReverseCulling = IsLocalToWorldDeterminantNegative();
+				Mesh.Type = PT_TriangleList;
+				Mesh.DepthPriorityGroup = SDPG_World;
+				Mesh.LODIndex = LODIndex;
+				Mesh.CastShadow = true;
+				Mesh.Elements.Empty(MaxElementsPerBatch);
+
+				const int32 EndChunk = FMath::Min(FirstChunk + MaxElementsPerBatch, Chunks.Num());
+				for (int32 ChunkIndex = FirstChunk; ChunkIndex < EndChunk; ++ChunkIndex)
+				{
+					// Chunks too small for the level use their coarsest one
+					const FHeightfieldMeshChunk& Chunk = Chunks[ChunkIndex];
+					const FHeightfieldMeshChunkLOD& LOD = Chunk.LODs[FMath::Min(LODIndex, Chunk.LODs.Num() - 1)];
+
+					FMeshBatchElement& BatchElement = Mesh.Elements.AddDefaulted_GetRef();
+					BatchElement.IndexBuffer = &IndexBuffer;
+					BatchElement.FirstIndex = LOD.FirstIndex;
+					BatchElement.NumPrimitives = LOD.NumTriangles;
+					BatchElement.BaseVertexIndex = Chunk.FirstVertex;
+					BatchElement.MinVertexIndex = 0;
+					BatchElement.MaxVertexIndex = Chunk.NumVertices - 1;
+				}
+
+				PDI->DrawMesh(Mesh, FLT_MAX);
+			}
+		}
+	}
+
+	virtual bool IsUsingCustomLODRules() const override
+	{
+		return bCacheDrawCommands;
+	}
+
+	/** Detail level of the cached batches, the level the nearest chunk would get on the per-frame path */
+	virtual FLODMask GetCustomLOD(const FSceneView& InView, float InViewLODScale, int32 InForcedLODLevel, float& OutScreenSizeSquared) const override
+	{
+		const FBoxSphereBounds& Bounds = GetBounds();
+		OutScreenSizeSquared = ComputeBoundsScreenRadiusSquared(Bounds.Origin, Bounds.SphereRadius, InView);
+
+		FLODMask LODMask;
+		if (InForcedLODLevel >= 0)
+		{
+			LODMask.SetLOD(FMath::Min(InForcedLODLevel, NumLODs - 1));
+		}
+		else
+		{
+			const double Distance = FMath::Sqrt(Bounds.GetBox().ComputeSquaredDistanceToPoint(InView.ViewMatrices.GetViewOrigin()));
+			LODMask.SetLOD(SelectChunkLOD(Distance, NumLODs));
+		}
+		return LODMask;
+	}
+
+	virtual void GetDynamicMeshElements(const TArray<const FSceneView*>& Views, const FSceneViewFamily& ViewFamily, uint32 VisibilityMap, FMeshElementCollector& Collector) const override
+	{
+		if (NumVertices == 0 || NumIndices == 0 || Nodes.Num() == 0 || bLostRenderData)
+		{
+			return;
+		}
+
+		const bool bWireframe = AllowDebugViewmodes() && ViewFamily.EngineShowFlags.Wireframe;
+
+		FMaterialRenderProxy* MaterialProxy = Material->GetRenderProxy();
+		const FMatrix& LocalToWorld = GetLocalToWorld();
+
+		for (int32 ViewIndex = 0; ViewIndex < Views.Num(); ++ViewIndex)
+		{
+			if (VisibilityMap & (1 << ViewIndex))
+			{
+				const FSceneView* View = Views[ViewIndex];
+				const FVector ViewOrigin = View->ViewMatrices.GetViewOrigin();
+
+				FDynamicPrimitiveUniformBuffer& DynamicPrimitiveUniformBuffer = Collector.AllocateOneFrameResource<FDynamicPrimitiveUniformBuffer>();
+				DynamicPrimitiveUniformBuffer.Set(Collector.GetRHICommandList(), GetLocalToWorld(), GetLocalToWorld(), GetBounds(), GetLocalBounds(), true, false, AlwaysHasVelocity());
+
+				// Visible chunks go into as many batches as the element limit asks for
+				FMeshBatch* Mesh = nullptr;
+				auto AddBatchElement = [&]() -> FMeshBatchElement&
+				{
+					if (Mesh && Mesh->Elements.Num() == MaxElementsPerBatch)
+					{
+						Collector.AddMesh(ViewIndex, *Mesh);
+						Mesh = nullptr;
+					}
+
+					if (!Mesh)
+					{
+						Mesh = &Collector.AllocateMesh();
+						Mesh->Elements.Empty(MaxElementsPerBatch);
+						Mesh->bWireframe = bWireframe;
+						Mesh->VertexFactory = &VertexFactory;
+						Mesh->MaterialRenderProxy = MaterialProxy;
+						Mesh->ReverseCulling = IsLocalToWorldDeterminantNegative();
+						Mesh->Type = PT_TriangleList;
+						Mesh->DepthPriorityGroup = SDPG_World;
+						Mesh->bCanApplyViewModeOverrides = true;
+					}
+					return Mesh->Elements.AddDefaulted_GetRef();
+				};
+
+				// Walk the quadtree, skipping frustum tests below nodes that are fully inside
+				TArray<TPair<int32, bool>, TInlineAllocator<64>> Stack;
+				Stack.Emplace(0, false);
+				while (Stack.Num() > 0)
+				{
+					const TPair<int32, bool> Entry = Stack.Pop(EAllowShrinking::No);
+					const FHeightfieldMeshQuadtreeNode& Node = Nodes[Entry.Key];
+					const FBox WorldBox = Node.LocalBounds.TransformBy(LocalToWorld);
+
+					bool bFullyInside = Entry.Value;
+					if (!bFullyInside && !View->ViewFrustum.IntersectBox(WorldBox.GetCenter(), WorldBox.GetExtent(), bFullyInside))
+					{
+						continue;
+					}
+
+					if (Node.ChunkIndex == INDEX_NONE)
+					{
+						for (int32 ChildIndex : Node.Children)
+						{
+							if (ChildIndex != INDEX_NONE)
+							{
+								Stack.Emplace(ChildIndex, bFullyInside);
+							}
+						}
+						continue;
+					}
+
+					// One batch element per visible chunk, at the detail level for its distance
+					const FHeightfieldMeshChunk& Chunk = Chunks[Node.ChunkIndex];
+					const double Distance = FMath::Sqrt(WorldBox.ComputeSquaredDistanceToPoint(ViewOrigin));
+					const FHeightfieldMeshChunkLOD& LOD = Chunk.LODs[SelectChunkLOD(Distance, Chunk.LODs.Num())];
+
+					FMeshBatchElement& BatchElement = AddBatchElement();
+					BatchElement.IndexBuffer = &IndexBuffer;
+					BatchElement.PrimitiveUniformBufferResource = &DynamicPrimitiveUniformBuffer.UniformBuffer;
+					BatchElement.FirstIndex = LOD.FirstIndex;
+					BatchElement.NumPrimitives = LOD.NumTriangles;
+					BatchElement.BaseVertexIndex = Chunk.FirstVertex;
+					BatchElement.MinVertexIndex = 0;
+					BatchElement.MaxVertexIndex = Chunk.NumVertices - 1;
+				}
+
+				if (Mesh)
+				{
+					Collector.AddMesh(ViewIndex, *Mesh);
+				}
+			}
+		}
+	}
+
+	/** Applies a partial vertex update to the existing GPU buffers */
+	void UpdateRegion_RenderThread(FRHICommandListImmediate& RHICmdList, const FHeightfieldMeshRegionUpdate& Update)
+	{
+		check(IsInRenderingThread());
+
+		// Back to the per-frame path until the edits settle, which also culls against the updated chunk bounds
+		LastEditFrame = GFrameNumberRenderThread;
+
+		// One run per chunk, each buffer is locked once for it
+		int32 SourceIndex = 0;
+		for (const FHeightfieldMeshRegionUpdate::FVertexRun& Run : Update.Runs)
+		{
+			FVector3f* Positions = static_cast<FVector3f*>(PositionBuffer.LockVertices(RHICmdList, Run.FirstVertex, Run.NumVertices));
+			FPackedNormal* TangentBasis = static_cast<FPackedNormal*>(TangentBuffer.LockVertices(RHICmdList, Run.FirstVertex, Run.NumVertices));
+
+			for (int32 i = 0; i < Run.NumVertices; ++i, ++SourceIndex)
+			{
+				Positions[i] = Update.Positions[SourceIndex];
+				PackTangentBasis(Update.Normals[SourceIndex], &TangentBasis[i * 2]);
+			}
+
+			PositionBuffer.UnlockVertices(RHICmdList);
+			TangentBuffer.UnlockVertices(RHICmdList);
+		}
+
+		for (const TPair<int32, FBox>& ChunkBound : Update.ChunkBounds)
+		{
+			Chunks[ChunkBound.Key].LocalBounds = ChunkBound.Value;
+
+			// The leaf takes the new bounds and each enclosing node is rebuilt from its children, so they shrink as well as grow
+			const int32 LeafIndex = ChunkToNode[ChunkBound.Key];
+			Nodes[LeafIndex].LocalBounds = ChunkBound.Value;
+			for (int32 NodeIndex = Nodes[LeafIndex].Parent; NodeIndex != INDEX_NONE; NodeIndex = Nodes[NodeIndex].Parent)
+			{
+				FHeightfieldMeshQuadtreeNode& Node = Nodes[NodeIndex];
+				Node.LocalBounds = FBox(ForceInit);
+				for (int32 ChildIndex : Node.Children)
+				{
+					if (ChildIndex != INDEX_NONE)
+					{
+						Node.LocalBounds += Nodes[ChildIndex].LocalBounds;
+					}
+				}
+			}
+		}
+	}
+
+	virtual FPrimitiveViewRelevance GetViewRelevance(const FSceneView* View) const override
+	{
+		FPrimitiveViewRelevance Result;
+		Result.bDrawRelevance = IsShown(View) && !bLostRenderData;
+		Result.bShadowRelevance = IsShadowCast(View);
+
+		// Debug view modes such as wireframe need the per-frame batches
+		const bool bDrawStatic = bCacheDrawCommands && !IsBeingEdited() && !IsRichView(*View->Family);
+		Result.bStaticRelevance = bDrawStatic;
+		Result.bDynamicRelevance = !bDrawStatic;
+		Result.bRenderInMainPass = ShouldRenderInMainPass();
+		Result.bUsesLightingChannels = GetLightingChannelMask() != GetDefaultLightingChannelMask();
+		Result.bRenderCustomDepth = ShouldRenderCustomDepth();
+		MaterialRelevance.SetPrimitiveViewRelevance(Result);
+		return Result;
+	}
+
+	virtual uint32 GetMemoryFootprint() const override
+	{
+		return sizeof(*this) + GetAllocatedSize();
+	}
+
+private:
+	/** Most elements of a batch, the width of the element masks of draw command building */
+	static constexpr int32 MaxElementsPerBatch = 64;
+
+	/** Recursively builds the quadtree node covering chunks [X0, X1) x [Y0, Y1), returns its index */
+	int32 BuildQuadtreeNode(int32 X0, int32 Y0, int32 X1, int32 Y1, int32 NumChunksX, int32 Parent)
+	{
+		const int32 NodeIndex = Nodes.AddDefaulted();
+		Nodes[NodeIndex].Parent = Parent;
+
+		if (X1 - X0 == 1 && Y1 - Y0 == 1)
+		{
+			const int32 ChunkIndex = Y0 * NumChunksX + X0;
+			Nodes[NodeIndex].ChunkIndex = ChunkIndex;
+			Nodes[NodeIndex].LocalBounds = Chunks[ChunkIndex].LocalBounds;
+			ChunkToNode[ChunkIndex] = NodeIndex;
+			return NodeIndex;
+		}
+
+		const int32 MidX = X0 + (X1 - X0 + 1) / 2;
+		const int32 MidY = Y0 + (Y1 - Y0 + 1) / 2;
+		const int32 ChildRects[4][4] = {
+			{ X0, Y0, MidX, MidY },
+			{ MidX, Y0, X1, MidY },
+			{ X0, MidY, MidX, Y1 },
+			{ MidX, MidY, X1, Y1 }
+		};
+
+		for (int32 Child = 0; Child < 4; ++Child)
+		{
+			const int32* Rect = ChildRects[Child];
+			if (Rect[0] < Rect[2] && Rect[1] < Rect[3])
+			{
+				const int32 ChildIndex = BuildQuadtreeNode(Rect[0], Rect[1], Rect[2], Rect[3], NumChunksX, NodeIndex);
+				Nodes[NodeIndex].Children[Child] = ChildIndex;
+				Nodes[NodeIndex].LocalBounds += Nodes[ChildIndex].LocalBounds;
+			}
+		}
+
+		return NodeIndex;
+	}
+
+	/** True within a few frames of the last region update */
+	bool IsBeingEdited() const
+	{
+		constexpr uint32 EditSettleFrames = 30;
+		return LastEditFrame != MAX_uint32 && GFrameNumberRenderThread - LastEditFrame < EditSettleFrames;
+	}
+
+	/** Detail level for a chunk at the given distance from the view. Each level covers twice the distance of the previous one. */
+	int32 SelectChunkLOD(double Distance, int32 NumChunkLODs) const
+	{
+		if (Distance <= LOD0Distance || NumChunkLODs <= 1)
+		{
+			return 0;
+		}
+
+		const int32 Level = 1 + FMath::FloorToInt32(FMath::Log2(Distance / LOD0Distance));
+		return FMath::Min(Level, NumChunkLODs - 1);
+	}
+
+	TArray<FHeightfieldMeshChunk> Chunks;
+	int32 NumVertices = 0;
+	int32 NumIndices = 0;
+
+	/** Quadtree over the chunks, root at index 0 */
+	TArray<FHeightfieldMeshQuadtreeNode> Nodes;
+	TArray<int32> ChunkToNode;
+	float LOD0Distance = 10000.0f;
+
+	/** Most detail levels of any chunk */
+	int32 NumLODs = 1;
+
+	/** Draw through cached mesh draw commands while not being edited */
+	bool bCacheDrawCommands = false;
+
+	/** Render thread frame of the last region update */
+	uint32 LastEditFrame = MAX_uint32;
+
+	/** Set once a buffer was re-initialized without its render data */
+	bool bLostRenderData = false;
+
+	TWeakObjectPtr<UHeightfieldMeshComponent> WeakComponent;
+
+	UMaterialInterface* Material;
+	FMaterialRelevance MaterialRelevance;
+
+	FHeightfieldMeshStreamBuffer PositionBuffer;
+	FHeightfieldMeshStreamBuffer TangentBuffer;
+	FHeightfieldMeshStreamBuffer TexCoordBuffer;
+	FHeightfieldMeshIndexBuffer IndexBuffer;
+	FLocalVertexFactory VertexFactory;
+};
+
+UHeightfieldMeshComponent::UHeightfieldMeshComponent(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	PrimaryComponentTick.bCanEverTick = false;
+}
+
+/** False without a renderer (dedicated server, -nullrhi): the mesh is never drawn, so it is neither built nor kept */
+static bool CanBuildRenderMesh()
+{
+	return !UHeightfieldDataSubsystem::IsRunningWithoutRenderer();
+}
+
+FPrimitiveSceneProxy* UHeightfieldMeshComponent::CreateSceneProxy()
+{
+	if (!CanBuildRenderMesh())
+	{
+		return nullptr;
+	}
+
+	if (!Geometry.HeightData.IsValid() && !IsBuildPending())
+	{
+		RebuildMesh();
+	}
+
+	// Nothing to show until the first (possibly background) build lands
+	if (Geometry.Chunks.Num() == 0)
+	{
+		return nullptr;
+	}
+
+	// The previous proxy released its render data after upload, regenerate it
+	// from the cached heights (no texture decode needed)
+	if (!PendingRenderData.IsValid())
+	{
+		PendingRenderData = Geometry.GenerateRenderData(nullptr);
+	}
+
+	// Hand the render data over to the proxy, the component does not keep a copy
+	return new FHeightfieldMeshSceneProxy(this, MoveTemp(PendingRenderData));
+}
+
+int32 UHeightfieldMeshComponent::GetNumMaterials() const
+{
+	return 1;
+}
+
+UMaterialInterface* UHeightfieldMeshComponent::GetMaterial(int32 MaterialIndex) const
+{
+	if (MaterialIndex == 0 && TerrainMaterial)
+	{
+		return TerrainMaterial;
+	}
+	return UMaterial::GetDefaultMaterial(MD_Surface);
+}
+
+void UHeightfieldMeshComponent::SetMaterial(int32 ElementIndex, UMaterialInterface* Material)
+{
+	if (ElementIndex == 0)
+	{
+		TerrainMaterial = Material;
+		MarkRenderStateDirty();
+	}
+}
+
+FBoxSphereBounds UHeightfieldMeshComponent::CalcBounds(const FTransform& LocalToWorld) const
+{
+	if (Geometry.CachedLocalBounds.IsValid)
+	{
+		return FBoxSphereBounds(Geometry.CachedLocalBounds.TransformBy(LocalToWorld));
+	}
+	return FBoxSphereBounds(LocalToWorld.GetLocation(), FVector::ZeroVector, 0.0f);
+}
+
+#if WITH_EDITOR
+void UHeightfieldMeshComponent::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	const FName PropertyName = PropertyChangedEvent.Property ?
+		PropertyChangedEvent.Property->GetFName() : NAME_None;
+
+	if (PropertyName == GET_MEMBER_NAME_CHECKED(UHeightfieldMeshComponent, HeightmapTexture) ||
+		PropertyName == GET_MEMBER_NAME_CHECKED(UHeightfieldMeshComponent, HeightfieldScale) ||
+		PropertyName == GET_MEMBER_NAME_CHECKED(UHeightfieldMeshComponent, LODFactor) ||
+		PropertyName == GET_MEMBER_NAME_CHECKED(UHeightfieldMeshComponent, ChunkSize) ||
+		PropertyName == GET_MEMBER_NAME_CHECKED(UHeightfieldMeshComponent, NumChunkLODs) ||
+		PropertyName == GET_MEMBER_NAME_CHECKED(UHeightfieldMeshComponent, SkirtDepth) ||
+		PropertyName == GET_MEMBER_NAME_CHECKED(UHeightfieldMeshComponent, bAdaptiveTriangulation) ||
+		PropertyName == GET_MEMBER_NAME_CHECKED(UHeightfieldMeshComponent, AdaptiveMaxError))
+	{
+		RebuildMesh();
+	}
+	else if (PropertyName == GET_MEMBER_NAME_CHECKED(UHeightfieldMeshComponent, bUseCompactVertexFormat) ||
+		PropertyName == GET_MEMBER_NAME_CHECKED(UHeightfieldMeshComponent, bOptimizeIndexOrder))
+	{
+		if (IsBuildPending())
+		{
+			// The running build copied the old settings
+			RebuildMesh();
+		}
+		else
+		{
+			// Layout is unchanged, only the vertex and index streams need regenerating
+			Geometry.bUseCompactVertexFormat = bUseCompactVertexFormat;
+			Geometry.bOptimizeIndexOrder = bOptimizeIndexOrder;
+			PendingRenderData.Reset();
+			MarkRenderStateDirty();
+		}
+	}
+	else if (PropertyName == GET_MEMBER_NAME_CHECKED(UHeightfieldMeshComponent, LOD0Distance) ||
+		PropertyName == GET_MEMBER_NAME_CHECKED(UHeightfieldMeshComponent, bCacheDrawCommands))
+	{
+		MarkRenderStateDirty();
+	}
+}
+#endif
+
+FArchive& operator<<(FArchive& Ar, FHeightfieldMeshRenderData& RenderData)
+{
+	RenderData.Positions.BulkSerialize(Ar);
+	RenderData.TangentBasis.BulkSerialize(Ar);
+	RenderData.TexCoords.BulkSerialize(Ar);
+	RenderData.CompactTexCoords.BulkSerialize(Ar);
+	RenderData.Indices.BulkSerialize(Ar);
+	RenderData.Indices16.BulkSerialize(Ar);
+	return Ar;
+}
+
+FArchive& operator<<(FArchive& Ar, FHeightfieldMeshGeometry& Geometry)
+{
+	Ar << Geometry.SourceTextureId << Geometry.HeightfieldScale << Geometry.LODFactor << Geometry.ChunkSize;
+	Ar << Geometry.NumChunkLODs << Geometry.SkirtDepth << Geometry.bUseCompactVertexFormat << Geometry.bOptimizeIndexOrder;
+	Ar << Geometry.bAdaptiveTriangulation << Geometry.AdaptiveMaxError;
+
+	if (Ar.IsLoading())
+	{
+		Geometry.HeightData = MakeShared<FHeightfieldData, ESPMode::ThreadSafe>();
+	}
+	Ar << *Geometry.HeightData;
+	Ar << Geometry.TextureWidth << Geometry.TextureHeight;
+
+	Ar << Geometry.Chunks;
+	Ar << Geometry.MeshStepSize << Geometry.MeshVertsX << Geometry.MeshVertsY << Geometry.MeshChunkSize;
+	Ar << Geometry.NumChunksX << Geometry.NumChunksY << Geometry.MeshNumVertices << Geometry.MeshNumIndices;
+	Ar << Geometry.bMeshHasSkirts << Geometry.bUse16BitIndices << Geometry.CachedLocalBounds;
+	return Ar;
+}
+
+void UHeightfieldMeshComponent::Serialize(FArchive& Ar)
+{
+	Super::Serialize(Ar);
+
+	Ar.UsingCustomVersion(FHeightfieldMeshCustomVersion::GUID);
+	if (Ar.CustomVer(FHeightfieldMeshCustomVersion::GUID) < FHeightfieldMeshCustomVersion::CookedMeshData)
+	{
+		return;
+	}
+
+	// Cooked packages carry the finished mesh, so loading a level does not
+	// have to decode the texture and generate the mesh again
+	bool bHasCookedMesh = false;
+	FHeightfieldMeshGeometry CookedGeometry;
+	FHeightfieldMeshRenderDataPtr CookedRenderData;
+
+#if WITH_EDITOR
+	if (Ar.IsCooking())
+	{
+		CookedRenderData = BuildGeometry(CookedGeometry);
+		bHasCookedMesh = CookedRenderData.IsValid();
+	}
+#endif
+
+	Ar << bHasCookedMesh;
+	if (!bHasCookedMesh)
+	{
+		return;
+	}
+
+	if (Ar.IsLoading())
+	{
+		CookedRenderData = MakeShared<FHeightfieldMeshRenderData, ESPMode::ThreadSafe>();
+	}
+
+	Ar << CookedGeometry;
+	Ar << *CookedRenderData;
+
+	// Read past and dropped without a renderer
+	if (Ar.IsLoading() && CanBuildRenderMesh())
+	{
+		Geometry = MoveTemp(CookedGeometry);
+		PendingRenderData = MoveTemp(CookedRenderData);
+	}
+}
+
+void UHeightfieldMeshComponent::PostLoad()
+{
+	Super::PostLoad();
+
+	// The texture is loaded by now, drop cooked data that no longer matches it
+	if (Geometry.IsValid() && !IsBuiltWithCurrentSettings(Geometry))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("HeightfieldMesh: Cooked mesh of %s is out of date, rebuilding"), *GetPathName());
+		Geometry = FHeightfieldMeshGeometry();
+		PendingRenderData.Reset();
+	}
+}
+
+void UHeightfieldMeshComponent::OnRegister()
+{
+	// Cooked geometry carries its own heights, share them so other components
+	// using the heightmap don't decode the texture again
+	const UWorld* World = GetWorld();
+	UHeightfieldDataSubsystem* DataSubsystem = World ? World->GetSubsystem<UHeightfieldDataSubsystem>() : nullptr;
+	if (DataSubsystem && Geometry.HeightData.IsValid() && !SourceHeightData.IsValid())
+	{
+		Geometry.HeightData = DataSubsystem->AddHeightfieldData(HeightmapTexture, Geometry.HeightData);
+	}
+	BindHeightData();
+
+	Super::OnRegister();
+}
+
+void UHeightfieldMeshComponent::OnUnregister()
+{
+	UnbindHeightData();
+
+	Super::OnUnregister();
+}
+
+void UHeightfieldMeshComponent::CopySettingsTo(FHeightfieldMeshGeometry& OutGeometry) const
+{
+	OutGeometry.SourceTextureId = FHeightfieldData::GetTextureSourceId(HeightmapTexture);
+	OutGeometry.HeightfieldScale = HeightfieldScale;
+	OutGeometry.LODFactor = LODFactor;
+	OutGeometry.ChunkSize = ChunkSize;
+	OutGeometry.NumChunkLODs = NumChunkLODs;
+	OutGeometry.SkirtDepth = SkirtDepth;
+	OutGeometry.bUseCompactVertexFormat = bUseCompactVertexFormat;
+	OutGeometry.bOptimizeIndexOrder = bOptimizeIndexOrder;
+	OutGeometry.bAdaptiveTriangulation = bAdaptiveTriangulation;
+	OutGeometry.AdaptiveMaxError = AdaptiveMaxError;
+}
+
+bool UHeightfieldMeshComponent::IsBuiltWithCurrentSettings(const FHeightfieldMeshGeometry& InGeometry) const
+{
+	FHeightfieldMeshGeometry Current;
+	CopySettingsTo(Current);
+
+	// Without the texture source there is nothing to compare the cooked id against
+	const bool bSameSource = !Current.SourceTextureId.IsValid() || InGeometry.SourceTextureId == Current.SourceTextureId;
+	return bSameSource &&
+		InGeometry.HeightfieldScale.Equals(Current.HeightfieldScale) &&
+		InGeometry.LODFactor == Current.LODFactor &&
+		InGeometry.ChunkSize == Current.ChunkSize &&
+		InGeometry.NumChunkLODs == Current.NumChunkLODs &&
+		InGeometry.SkirtDepth == Current.SkirtDepth &&
+		InGeometry.bUseCompactVertexFormat == Current.bUseCompactVertexFormat &&
+		InGeometry.bOptimizeIndexOrder == Current.bOptimizeIndexOrder &&
+		InGeometry.bAdaptiveTriangulation == Current.bAdaptiveTriangulation &&
+		InGeometry.AdaptiveMaxError == Current.AdaptiveMaxError;
+}
+
+FHeightfieldMeshRenderDataPtr UHeightfieldMeshComponent::BuildGeometry(FHeightfieldMeshGeometry& OutGeometry) const
+{
+	CopySettingsTo(OutGeometry);
+
+	const FHeightfieldDataPtr Data = SourceHeightData.IsValid() ?
+		SourceHeightData : UHeightfieldDataSubsystem::GetHeightfieldData(this, HeightmapTexture);
+	return Data.IsValid() ? OutGeometry.Build(Data) : nullptr;
+}
+
+void UHeightfieldMeshComponent::SetHeightData(const FHeightfieldDataPtr& NewHeightData)
+{
+	if (SourceHeightData != NewHeightData)
+	{
+		SourceHeightData = NewHeightData;
+		RebuildMesh();
+	}
+}
+
+void UHeightfieldMeshComponent::RebuildMesh()
+{
+	if (!CanBuildRenderMesh())
+	{
+		return;
+	}
+
+	if (bBuildAsync)
+	{
+		RebuildMeshAsync();
+		return;
+	}
+
+	// Supersedes any background build still in flight
+	PendingBuild.Reset();
+
+	FHeightfieldMeshGeometry NewGeometry;
+	FHeightfieldMeshRenderDataPtr NewRenderData = BuildGeometry(NewGeometry);
+	ApplyBuild(MoveTemp(NewGeometry), MoveTemp(NewRenderData));
+}
+
+void UHeightfieldMeshComponent::RebuildMeshAsync(int32 NumStaleRestarts)
+{
+	if (!HeightmapTexture && !SourceHeightData.IsValid())
+	{
+		PendingBuild.Reset();
+		ApplyBuild(FHeightfieldMeshGeometry(), nullptr);
+		return;
+	}
+
+	// Any build still in flight is superseded, its result is dropped when it completes
+	const TSharedPtr<FHeightfieldMeshAsyncBuild, ESPMode::ThreadSafe> Build = MakeShared<FHeightfieldMeshAsyncBuild, ESPMode::ThreadSafe>();
+	CopySettingsTo(Build->Geometry);
+	Build->Texture.Reset(HeightmapTexture);
+	Build->NumStaleRestarts = NumStaleRestarts;
+	PendingBuild = Build;
+
+	// Reuse the heights if another component already decoded the heightmap, else decode them in the task
+	const UWorld* World = GetWorld();
+	const UHeightfieldDataSubsystem* DataSubsystem = World ? World->GetSubsystem<UHeightfieldDataSubsystem>() : nullptr;
+	FHeightfieldDataPtr Data = SourceHeightData;
+	if (!Data.IsValid() && DataSubsystem)
+	{
+		Data = DataSubsystem->FindHeightfieldData(HeightmapTexture);
+	}
+
+	// Remember what gets edited while the task runs, in case the build has to be applied anyway
+	if (Data.IsValid())
+	{
+		Build->EditedHandle = Data->OnRegionChanged().AddLambda(
+			[WeakBuild = TWeakPtr<FHeightfieldMeshAsyncBuild, ESPMode::ThreadSafe>(Build)](int32 StartRow, int32 StartCol, int32 NumRows, int32 NumCols)
+			{
+				if (const TSharedPtr<FHeightfieldMeshAsyncBuild, ESPMode::ThreadSafe> EditedBuild = WeakBuild.Pin())
+				{
+					const FIntRect Region(StartCol, StartRow, StartCol + NumCols, StartRow + NumRows);
+					if (EditedBuild->bHasEditedRegion)
+					{
+						EditedBuild->EditedRegion.Union(Region);
+					}
+					else
+					{
+						EditedBuild->EditedRegion = Region;
+						EditedBuild->bHasEditedRegion = true;
+					}
+				}
+			});
+	}
+
+	TWeakObjectPtr<UHeightfieldMeshComponent> WeakThis(this);
+	Build->Task = UE::Tasks::Launch(UE_SOURCE_LOCATION, [Build, Data, WeakThis]()
+	{
+		if (Data.IsValid())
+		{
+			// Built from a copy taken under a short read lock, so edits on the game thread never wait for the whole build
+			FHeightfieldDataPtr Snapshot;
+			{
+				FReadScopeLock ReadLock(Data->GetLock());
+				Snapshot = Data->CreateSnapshot();
+			}
+			Build->SourceRevision = Snapshot->GetRevision();
+			Build->RenderData = Build->Geometry.Build(Snapshot);
+			Build->Geometry.HeightData = Data;
+		}
+		else
+		{
+			// Nobody else can edit heights decoded here until they are shared on completion
+			const FHeightfieldDataPtr DecodedData = FHeightfieldData::CreateFromTexture(Build->Texture.Get());
+			Build->bDecodedHeightData = true;
+			Build->RenderData = DecodedData.IsValid() ? Build->Geometry.Build(DecodedData) : nullptr;
+		}
+
+		// Hand the result back on the game thread, which is also where the texture reference is dropped
+		AsyncTask(ENamedThreads::GameThread, [Build, Data, WeakThis]()
+		{
+			if (Data.IsValid())
+			{
+				Data->OnRegionChanged().Remove(Build->EditedHandle);
+			}
+
+			if (UHeightfieldMeshComponent* Component = WeakThis.Get())
+			{
+				Component->CompleteAsyncBuild(Build);
+			}
+			Build->Texture.Reset();
+			Build->Task = UE::Tasks::FTask();
+		});
+	});
+}
+
+void UHeightfieldMeshComponent::CompleteAsyncBuild(const TSharedPtr<FHeightfieldMeshAsyncBuild, ESPMode::ThreadSafe>& Build, bool bCanRestart)
+{
+	// Superseded by a newer build, or already applied by WaitForPendingBuild
+	if (Build != PendingBuild)
+	{
+		return;
+	}
+
+	PendingBuild.Reset();
+
+	// Share freshly decoded heights, or switch to the ones another component decoded in the meantime
+	const UWorld* World = GetWorld();
+	UHeightfieldDataSubsystem* DataSubsystem = World ? World->GetSubsystem<UHeightfieldDataSubsystem>() : nullptr;
+	if (DataSubsystem && Build->bDecodedHeightData && Build->Geometry.HeightData.IsValid())
+	{
+		const FHeightfieldDataPtr SharedData = DataSubsystem->AddHeightfieldData(Build->Texture.Get(), Build->Geometry.HeightData);
+
+		// The mesh shows the texture as decoded, the shared heights may have been edited since they were
+		if (SharedData != Build->Geometry.HeightData && SharedData->GetRevision() != 0)
+		{
+			if (bCanRestart)
+			{
+				RebuildMeshAsync(Build->NumStaleRestarts);
+			}
+			else
+			{
+				FHeightfieldMeshGeometry NewGeometry;
+				FHeightfieldMeshRenderDataPtr NewRenderData = BuildGeometry(NewGeometry);
+				ApplyBuild(MoveTemp(NewGeometry), MoveTemp(NewRenderData));
+			}
+			return;
+		}
+
+		Build->Geometry.HeightData = SharedData;
+	}
+
+	// Built from a snapshot the heights were edited past in the meantime. Start over with the current heights,
+	// unless edits keep coming: then the build lands and the edited samples are patched on top
+	constexpr int32 MaxStaleRestarts = 2;
+	const bool bStale = !Build->bDecodedHeightData && Build->Geometry.HeightData.IsValid() &&
+		Build->Geometry.HeightData->GetRevision() != Build->SourceRevision;
+	if (bStale && bCanRestart && Build->NumStaleRestarts < MaxStaleRestarts)
+	{
+		RebuildMeshAsync(Build->NumStaleRestarts + 1);
+		return;
+	}
+
+	ApplyBuild(MoveTemp(Build->Geometry), MoveTemp(Build->RenderData));
+
+	if (bStale && Build->bHasEditedRegion && Geometry.IsValid())
+	{
+		const FIntRect& Region = Build->EditedRegion;
+		int32 StartRow = Region.Min.Y;
+		int32 StartCol = Region.Min.X;
+		int32 NumRows = Region.Height();
+		int32 NumCols = Region.Width();
+		if (Geometry.ClampRegion(StartRow, StartCol, NumRows, NumCols))
+		{
+			UpdateVerticesInRegion(StartRow, StartCol, NumRows, NumCols);
+		}
+	}
+}
+
+void UHeightfieldMeshComponent::WaitForPendingBuild()
+{
+	if (PendingBuild.IsValid())
+	{
+		// Whoever waits wants the mesh now, a stale build is patched rather than started over
+		const TSharedPtr<FHeightfieldMeshAsyncBuild, ESPMode::ThreadSafe> Build = PendingBuild;
+		Build->Task.Wait();
+		CompleteAsyncBuild(Build, false);
+	}
+}
+
+bool UHeightfieldMeshComponent::IsBuildPending() const
+{
+	return PendingBuild.IsValid();
+}
+
+void UHeightfieldMeshComponent::ApplyBuild(FHeightfieldMeshGeometry&& NewGeometry, FHeightfieldMeshRenderDataPtr NewRenderData)
+{
+	// Swapped in one go, the current proxy keeps rendering the old mesh until
+	// the render state is recreated at the end of the frame
+	Geometry = MoveTemp(NewGeometry);
+	PendingRenderData = MoveTemp(NewRenderData);
+
+	if (BoundHeightData != Geometry.HeightData)
+	{
+		UnbindHeightData();
+		if (IsRegistered())
+		{
+			BindHeightData();
+		}
+	}
+
+	if (PendingRenderData.IsValid())
+	{
+		UE_LOG(LogTemp, Log, TEXT("HeightfieldMesh: Built mesh with %d vertices, %d triangles in %d chunks"),
+			PendingRenderData->Positions.Num(), PendingRenderData->GetNumIndices() / 3, Geometry.Chunks.Num());
+	}
+
+	UpdateBounds();
+	MarkRenderStateDirty();
+
+	OnMeshBuilt.Broadcast(this);
+}
+
+FHeightfieldMeshRenderDataPtr FHeightfieldMeshGeometry::Build(const FHeightfieldDataPtr& InHeightData)
+{
+	HeightData = InHeightData;
+	TextureWidth = HeightData->GetWidth();
+	TextureHeight = HeightData->GetHeight();
+	return BuildFromHeights();
+}
+
+FHeightfieldMeshRenderDataPtr FHeightfieldMeshGeometry::BuildFromHeights()
+{
+	if (!LayoutChunks())
+	{
+		return nullptr;
+	}
+
+	TArray<FBox> ChunkBounds;
+	FHeightfieldMeshRenderDataPtr RenderData = GenerateRenderData(&ChunkBounds);
+
+	float MinZ = MAX_FLT, MaxZ = -MAX_FLT;
+	for (int32 ChunkIndex = 0; ChunkIndex < Chunks.Num(); ++ChunkIndex)
+	{
+		Chunks[ChunkIndex].LocalBounds = ChunkBounds[ChunkIndex];
+		MinZ = FMath::Min(MinZ, static_cast<float>(ChunkBounds[ChunkIndex].Min.Z));
+		MaxZ = FMath::Max(MaxZ, static_cast<float>(ChunkBounds[ChunkIndex].Max.Z));
+	}
+
+	// Update cached bounds
+	CachedLocalBounds = FBox(
+		FVector(0, 0, MinZ),
+		FVector(TextureWidth * HeightfieldScale.X, TextureHeight * HeightfieldScale.Y, MaxZ)
+	);
+
+	return RenderData;
+}
+
+bool FHeightfieldMeshGeometry::LayoutChunks()
+{
+	// Generate mesh with LOD
+	const int32 StepSize = FMath::Max(1, LODFactor);
+	const int32 VertsX = (TextureWidth + StepSize - 1) / StepSize;
+	const int32 VertsY = (TextureHeight + StepSize - 1) / StepSize;
+
+	if (VertsX < 2 || VertsY < 2)
+	{
+		return false;
+	}
 
-		// Get material
-		Material = Component->GetMaterial(0);
-		if (!Material)
-		{
-			Material = UMaterial::GetDefaultMaterial(MD_Surface);
-		}
+	// Split the quad grid into chunks that are culled individually
+	const int32 QuadsPerChunk = FMath::Max(1, ChunkSize);
+	NumChunksX = FMath::DivideAndRoundUp(VertsX - 1, QuadsPerChunk);
+	NumChunksY = FMath::DivideAndRoundUp(VertsY - 1, QuadsPerChunk);
+	MeshStepSize = StepSize;
+	MeshVertsX = VertsX;
+	MeshVertsY = VertsY;
+	MeshChunkSize = QuadsPerChunk;
 
-		// Build vertex buffer
-		VertexBuffers.InitWithDummyData(&VertexFactory, Vertices.Num(), 2);
+	// Skirts are only needed to hide cracks between chunks at different detail levels
+	const int32 NumLODs = FMath::Clamp(NumChunkLODs, 1, 6);
+	bMeshHasSkirts = NumLODs > 1 && SkirtDepth > 0.0f;
 
-		// Update vertex buffer with actual data
-		if (Vertices.Num() > 0)
+	// Lay out all chunks up front so every array can be sized exactly
+	// and each chunk can then be filled independently
+	MeshNumVertices = 0;
+	MeshNumIndices = 0;
+	bUse16BitIndices = true;
+	Chunks.Reset();
+	Chunks.SetNum(NumChunksX * NumChunksY);
+	for (int32 ChunkY = 0; ChunkY < NumChunksY; ++ChunkY)
+	{
+		for (int32 ChunkX = 0; ChunkX < NumChunksX; ++ChunkX)
 		{
-			for (int32 i = 0; i < Vertices.Num(); ++i)
+			FHeightfieldMeshChunk& Chunk = Chunks[ChunkY * NumChunksX + ChunkX];
+			Chunk.GridX = ChunkX * QuadsPerChunk;
+			Chunk.GridY = ChunkY * QuadsPerChunk;
+			Chunk.NumVertsX = FMath::Min(QuadsPerChunk, VertsX - 1 - Chunk.GridX) + 1;
+			Chunk.NumVertsY = FMath::Min(QuadsPerChunk, VertsY - 1 - Chunk.GridY) + 1;
+			Chunk.FirstVertex = MeshNumVertices;
+			Chunk.NumVertices = Chunk.NumVertsX * Chunk.NumVertsY + 2 * (Chunk.NumVertsX + Chunk.NumVertsY);
+			MeshNumVertices += Chunk.NumVertices;
+
+			// Indices are chunk-relative, so only the largest chunk decides the index size
+			bUse16BitIndices &= Chunk.NumVertices <= MAX_uint16 + 1;
+
+			for (int32 LODIndex = 0; LODIndex < NumLODs; ++LODIndex)
 			{
-				VertexBuffers.PositionVertexBuffer.VertexPosition(i) = FVector3f(Vertices[i]);
-				VertexBuffers.StaticMeshVertexBuffer.SetVertexTangents(
-					i,
-					FVector3f(1, 0, 0),
-					FVector3f(0, 1, 0),
-					FVector3f(Normals.IsValidIndex(i) ? Normals[i] : FVector::UpVector)
-				);
-				VertexBuffers.StaticMeshVertexBuffer.SetVertexUV(i, 0, FVector2f(UVs.IsValidIndex(i) ? UVs[i] : FVector2D::ZeroVector));
-				VertexBuffers.ColorVertexBuffer.VertexColor(i) = FColor::White;
+				FHeightfieldMeshChunkLOD& LOD = Chunk.LODs.AddDefaulted_GetRef();
+				LOD.NumTriangles = GetChunkLODIndexCount(Chunk, 1 << LODIndex, bMeshHasSkirts) / 3;
 			}
 		}
-
-		// Initialize index buffer
-		IndexBuffer.Indices = Indices;
-
-		// Enqueue initialization on render thread
-		BeginInitResource(&VertexBuffers.PositionVertexBuffer);
-		BeginInitResource(&VertexBuffers.StaticMeshVertexBuffer);
-		BeginInitResource(&VertexBuffers.ColorVertexBuffer);
-		BeginInitResource(&IndexBuffer);
-		BeginInitResource(&VertexFactory);
 	}
 
-	virtual ~FHeightfieldMeshSceneProxy()
+	// Adaptive chunks only know their triangle counts once they are triangulated
+	if (bAdaptiveTriangulation)
 	{
-		VertexBuffers.PositionVertexBuffer.ReleaseResource();
-		VertexBuffers.StaticMeshVertexBuffer.ReleaseResource();
-		VertexBuffers.ColorVertexBuffer.ReleaseResource();
-		IndexBuffer.ReleaseResource();
-		VertexFactory.ReleaseResource();
-	}
+		ParallelFor(Chunks.Num(), [this](int32 ChunkIndex)
+		{
+			FHeightfieldMeshChunk& Chunk = Chunks[ChunkIndex];
+			if (!FHeightfieldMeshRTIN::SupportsChunk(Chunk))
+			{
+				return;
+			}
 
-	virtual SIZE_T GetTypeHash() const override
-	{
-		static size_t UniquePointer;
-		return reinterpret_cast<size_t>(&UniquePointer);
+			const FHeightfieldMeshRTIN Surface(*this, Chunk);
+			for (int32 LODIndex = 0; LODIndex < Chunk.LODs.Num(); ++LODIndex)
+			{
+				const float MaxError = GetAdaptiveLODError(AdaptiveMaxError, LODIndex);
+				Chunk.LODs[LODIndex].NumTriangles = GetChunkLODIndexCount(Chunk, 1 << LODIndex, bMeshHasSkirts, &Surface, MaxError) / 3;
+			}
+		});
 	}
 
-	virtual void GetDynamicMeshElements(const TArray<const FSceneView*>& Views, const FSceneViewFamily& ViewFamily, uint32 VisibilityMap, FMeshElementCollector& Collector) const override
+	// Index ranges follow each other in chunk order
+	for (FHeightfieldMeshChunk& Chunk : Chunks)
 	{
-		if (Vertices.Num() == 0 || Indices.Num() == 0)
+		for (FHeightfieldMeshChunkLOD& LOD : Chunk.LODs)
 		{
-			return;
+			LOD.FirstIndex = MeshNumIndices;
+			MeshNumIndices += LOD.NumTriangles * 3;
 		}
+	}
 
-		const bool bWireframe = AllowDebugViewmodes() && ViewFamily.EngineShowFlags.Wireframe;
+	return true;
+}
 
-		FMaterialRenderProxy* MaterialProxy = Material->GetRenderProxy();
+FVector FHeightfieldMeshGeometry::GetGridVertexPosition(int32 X, int32 Y) const
+{
+	const int32 TexX = FMath::Min(X * MeshStepSize, TextureWidth - 1);
+	const int32 TexY = FMath::Min(Y * MeshStepSize, TextureHeight - 1);
+	return FVector(
+		TexX * HeightfieldScale.X,
+		TexY * HeightfieldScale.Y,
+		HeightFromRaw(HeightData->GetHeightAt(TexX, TexY))
+	);
+}
 
-		for (int32 ViewIndex = 0; ViewIndex < Views.Num(); ++ViewIndex)
-		{
-			if (VisibilityMap & (1 << ViewIndex))
-			{
-				FMeshBatch& Mesh = Collector.AllocateMesh();
-				FMeshBatchElement& BatchElement = Mesh.Elements[0];
+void FHeightfieldMeshGeometry::GetLocalZRange(const FHeightfieldHeightRange& Range, float& OutMinZ, float& OutMaxZ) const
+{
+	const float MinHeight = HeightFromRaw(Range.Min);
+	const float MaxHeight = HeightFromRaw(Range.Max);
+	OutMinZ = FMath::Min(MinHeight, MaxHeight) - (bMeshHasSkirts ? SkirtDepth : 0.0f);
+	OutMaxZ = FMath::Max(MinHeight, MaxHeight);
+}
 
-				BatchElement.IndexBuffer = &IndexBuffer;
-				Mesh.bWireframe = bWireframe;
-				Mesh.VertexFactory = &VertexFactory;
-				Mesh.MaterialRenderProxy = MaterialProxy;
+FBox FHeightfieldMeshGeometry::CalculateChunkBounds(const FHeightfieldMeshChunk& Chunk) const
+{
+	const int32 MinTexX = Chunk.GridX * MeshStepSize;
+	const int32 MinTexY = Chunk.GridY * MeshStepSize;
+	const int32 MaxTexX = FMath::Min((Chunk.GridX + Chunk.NumVertsX - 1) * MeshStepSize, TextureWidth - 1);
+	const int32 MaxTexY = FMath::Min((Chunk.GridY + Chunk.NumVertsY - 1) * MeshStepSize, TextureHeight - 1);
 
-				FDynamicPrimitiveUniformBuffer& DynamicPrimitiveUniformBuffer = Collector.AllocateOneFrameResource<FDynamicPrimitiveUniformBuffer>();
-				DynamicPrimitiveUniformBuffer.Set(Collector.GetRHICommandList(), GetLocalToWorld(), GetLocalToWorld(), GetBounds(), GetLocalBounds(), true, false, AlwaysHasVelocity());
-				BatchElement.PrimitiveUniformBufferResource = &DynamicPrimitiveUniformBuffer.UniformBuffer;
+	// Covers every texel under the chunk, so it also holds for texels skipped by the LOD step
+	float MinZ, MaxZ;
+	GetLocalZRange(HeightData->GetHeightRange(MinTexX, MinTexY, MaxTexX, MaxTexY), MinZ, MaxZ);
+	return FBox(
+		FVector(MinTexX * HeightfieldScale.X, MinTexY * HeightfieldScale.Y, MinZ),
+		FVector(MaxTexX * HeightfieldScale.X, MaxTexY * HeightfieldScale.Y, MaxZ));
+}
 
-				BatchElement.FirstIndex = 0;
-				BatchElement.NumPrimitives = Indices.Num() / 3;
-				BatchElement.MinVertexIndex = 0;
-				BatchElement.MaxVertexIndex = Vertices.Num() - 1;
-				Mesh.ReverseCulling = IsLocalToWorldDeterminantNegative();
-				Mesh.Type = PT_TriangleList;
-				Mesh.DepthPriorityGroup = SDPG_World;
-				Mesh.bCanApplyViewModeOverrides = true;
+FBox FHeightfieldMeshGeometry::CalculateMeshBounds() const
+{
+	float MinZ, MaxZ;
+	GetLocalZRange(HeightData->GetHeightRange(), MinZ, MaxZ);
+	return FBox(
+		FVector(0, 0, MinZ),
+		FVector(TextureWidth * HeightfieldScale.X, TextureHeight * HeightfieldScale.Y, MaxZ));
+}
 
-				Collector.AddMesh(ViewIndex, Mesh);
-			}
-		}
+FHeightfieldMeshRenderDataPtr FHeightfieldMeshGeometry::GenerateRenderData(TArray<FBox>* OutChunkBounds) const
+{
+	FHeightfieldMeshRenderDataPtr RenderData = MakeShared<FHeightfieldMeshRenderData, ESPMode::ThreadSafe>();
+	RenderData->Positions.SetNumUninitialized(MeshNumVertices);
+	RenderData->TangentBasis.SetNumUninitialized(MeshNumVertices * 2);
+	if (bUseCompactVertexFormat)
+	{
+		RenderData->CompactTexCoords.SetNumUninitialized(MeshNumVertices);
 	}
-
-	virtual FPrimitiveViewRelevance GetViewRelevance(const FSceneView* View) const override
+	else
 	{
-		FPrimitiveViewRelevance Result;
-		Result.bDrawRelevance = IsShown(View);
-		Result.bShadowRelevance = IsShadowCast(View);
-		Result.bDynamicRelevance = true;
-		Result.bRenderInMainPass = ShouldRenderInMainPass();
-		Result.bUsesLightingChannels = GetLightingChannelMask() != GetDefaultLightingChannelMask();
-		Result.bRenderCustomDepth = ShouldRenderCustomDepth();
-		MaterialRelevance.SetPrimitiveViewRelevance(Result);
-		return Result;
+		RenderData->TexCoords.SetNumUninitialized(MeshNumVertices);
+	}
+	if (bUse16BitIndices)
+	{
+		RenderData->Indices16.SetNumUninitialized(MeshNumIndices);
+	}
+	else
+	{
+		RenderData->Indices.SetNumUninitialized(MeshNumIndices);
 	}
 
-	virtual uint32 GetMemoryFootprint() const override
+	if (OutChunkBounds)
 	{
-		return sizeof(*this) + GetAllocatedSize();
+		OutChunkBounds->Init(FBox(ForceInit), Chunks.Num());
 	}
 
-private:
-	TArray<FVector> Vertices;
-	TArray<uint32> Indices;
-	TArray<FVector> Normals;
-	TArray<FVector2D> UVs;
+	FHeightfieldMeshRenderData& Data = *RenderData;
+	const float SkirtOffset = SkirtDepth;
+	const bool bCompactTexCoords = bUseCompactVertexFormat;
+	ParallelFor(Chunks.Num(), [this, &Data, OutChunkBounds, SkirtOffset, bCompactTexCoords](int32 ChunkIndex)
+	{
+		const FHeightfieldMeshChunk& Chunk = Chunks[ChunkIndex];
+		FBox ChunkBounds(ForceInit);
 
-	UMaterialInterface* Material;
-	FMaterialRelevance MaterialRelevance;
+		// Generate chunk vertices
+		int32 VertexIndex = Chunk.FirstVertex;
+		for (int32 Y = Chunk.GridY; Y < Chunk.GridY + Chunk.NumVertsY; ++Y)
+		{
+			const int32 TexY = FMath::Min(Y * MeshStepSize, TextureHeight - 1);
+			for (int32 X = Chunk.GridX; X < Chunk.GridX + Chunk.NumVertsX; ++X, ++VertexIndex)
+			{
+				const int32 TexX = FMath::Min(X * MeshStepSize, TextureWidth - 1);
+				const FVector Position = GetGridVertexPosition(X, Y);
 
-	FStaticMeshVertexBuffers VertexBuffers;
-	FDynamicMeshIndexBuffer32 IndexBuffer;
-	FLocalVertexFactory VertexFactory;
-};
+				Data.Positions[VertexIndex] = FVector3f(Position);
+				PackTangentBasis(FVector3f(CalculateNormalAt(TexX, TexY)), &Data.TangentBasis[VertexIndex * 2]);
+				const FVector2f TexCoord(
+					static_cast<float>(TexX) / (TextureWidth - 1),
+					static_cast<float>(TexY) / (TextureHeight - 1)
+				);
+				if (bCompactTexCoords)
+				{
+					Data.CompactTexCoords[VertexIndex].U = static_cast<uint16>(FMath::RoundToInt(TexCoord.X * 65535.0f));
+					Data.CompactTexCoords[VertexIndex].V = static_cast<uint16>(FMath::RoundToInt(TexCoord.Y * 65535.0f));
+				}
+				else
+				{
+					Data.TexCoords[VertexIndex] = TexCoord;
+				}
 
-UHeightfieldMeshComponent::UHeightfieldMeshComponent(const FObjectInitializer& ObjectInitializer)
-	: Super(ObjectInitializer)
-{
-	PrimaryComponentTick.bCanEverTick = false;
-	CachedLocalBounds.Init();
+				ChunkBounds += Position;
+			}
+		}
+
+		// Generate skirt vertices (copies of the edge vertices, pushed down)
+		auto AddSkirtVertex = [&Data, &Chunk, &VertexIndex, &ChunkBounds, SkirtOffset, bCompactTexCoords](int32 X, int32 Y)
+		{
+			const int32 GridVertex = Chunk.FirstVertex + Y * Chunk.NumVertsX + X;
+			Data.Positions[VertexIndex] = Data.Positions[GridVertex] - FVector3f(0.0f, 0.0f, SkirtOffset);
+			Data.TangentBasis[VertexIndex * 2] = Data.TangentBasis[GridVertex * 2];
+			Data.TangentBasis[VertexIndex * 2 + 1] = Data.TangentBasis[GridVertex * 2 + 1];
+			if (bCompactTexCoords)
+			{
+				Data.CompactTexCoords[VertexIndex] = Data.CompactTexCoords[GridVertex];
+			}
+			else
+			{
+				Data.TexCoords[VertexIndex] = Data.TexCoords[GridVertex];
+			}
+			ChunkBounds += FVector(Data.Positions[VertexIndex]);
+			++VertexIndex;
+		};
+		for (int32 X = 0; X < Chunk.NumVertsX; ++X) { AddSkirtVertex(X, 0); }
+		for (int32 X = 0; X < Chunk.NumVertsX; ++X) { AddSkirtVertex(X, Chunk.NumVertsY - 1); }
+		for (int32 Y = 0; Y < Chunk.NumVertsY; ++Y) { AddSkirtVertex(0, Y); }
+		for (int32 Y = 0; Y < Chunk.NumVertsY; ++Y) { AddSkirtVertex(Chunk.NumVertsX - 1, Y); }
+
+		// Generate chunk indices, one range per detail level
+		TOptional<FHeightfieldMeshRTIN> AdaptiveSurface;
+		if (bAdaptiveTriangulation && FHeightfieldMeshRTIN::SupportsChunk(Chunk))
+		{
+			AdaptiveSurface.Emplace(*this, Chunk);
+		}
+
+		for (int32 LODIndex = 0; LODIndex < Chunk.LODs.Num(); ++LODIndex)
+		{
+			const FHeightfieldMeshChunkLOD& LOD = Chunk.LODs[LODIndex];
+			const float MaxError = GetAdaptiveLODError(AdaptiveMaxError, LODIndex);
+			if (bUse16BitIndices)
+			{
+				WriteChunkLODIndices(&Data.Indices16[LOD.FirstIndex], Chunk, 1 << LODIndex, bMeshHasSkirts, bOptimizeIndexOrder, AdaptiveSurface.GetPtrOrNull(), MaxError);
+			}
+			else
+			{
+				WriteChunkLODIndices(&Data.Indices[LOD.FirstIndex], Chunk, 1 << LODIndex, bMeshHasSkirts, bOptimizeIndexOrder, AdaptiveSurface.GetPtrOrNull(), MaxError);
+			}
+		}
+
+		if (OutChunkBounds)
+		{
+			(*OutChunkBounds)[ChunkIndex] = ChunkBounds;
+		}
+	});
+
+	return RenderData;
 }
 
-FPrimitiveSceneProxy* UHeightfieldMeshComponent::CreateSceneProxy()
+void UHeightfieldMeshComponent::UpdateMeshRegion(int32 StartRow, int32 StartCol, int32 NumRows, int32 NumCols)
 {
-	if (Vertices.Num() == 0)
+	// Without a renderer the heights live with the collision, which re-reads nothing from the texture
+	if (!CanBuildRenderMesh())
 	{
-		RebuildMesh();
+		return;
 	}
 
-	if (Vertices.Num() > 0 && Indices.Num() > 0)
+	// Edits patch the current heights, so let a running rebuild land first
+	WaitForPendingBuild();
+
+	// Nothing built yet, so there is nothing to patch
+	if (!Geometry.IsValid())
 	{
-		return new FHeightfieldMeshSceneProxy(this);
+		RebuildMesh();
+		return;
 	}
 
-	return nullptr;
-}
+	if (!Geometry.ClampRegion(StartRow, StartCol, NumRows, NumCols))
+	{
+		return;
+	}
 
-int32 UHeightfieldMeshComponent::GetNumMaterials() const
-{
-	return 1;
-}
+	if (SourceHeightData.IsValid())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("HeightfieldMesh: %s isn't built from its texture, edit it with UpdateMeshRegionRaw"), *GetPathName());
+		return;
+	}
 
-UMaterialInterface* UHeightfieldMeshComponent::GetMaterial(int32 MaterialIndex) const
-{
-	if (MaterialIndex == 0 && TerrainMaterial)
+	// Re-decode only the touched texels, the mesh is patched from OnHeightDataChanged
+	if (!Geometry.HeightData->ReloadRegionFromTexture(HeightmapTexture, StartRow, StartCol, NumRows, NumCols))
 	{
-		return TerrainMaterial;
+		// Texture changed shape or format since the last build
+		RebuildMesh();
 	}
-	return UMaterial::GetDefaultMaterial(MD_Surface);
 }
 
-void UHeightfieldMeshComponent::SetMaterial(int32 ElementIndex, UMaterialInterface* Material)
+void UHeightfieldMeshComponent::UpdateMeshRegionRaw(TArrayView<const uint16> Heights, int32 StartRow, int32 StartCol, int32 NumRows, int32 NumCols)
 {
-	if (ElementIndex == 0)
+	if (Heights.Num() != NumRows * NumCols)
 	{
-		TerrainMaterial = Material;
-		MarkRenderStateDirty();
+		UE_LOG(LogTemp, Warning, TEXT("HeightfieldMesh: Heights array size (%d) doesn't match region size (%d x %d)"),
+			Heights.Num(), NumRows, NumCols);
+		return;
 	}
-}
 
-FBoxSphereBounds UHeightfieldMeshComponent::CalcBounds(const FTransform& LocalToWorld) const
-{
-	if (CachedLocalBounds.IsValid)
+	// Without a renderer there is no mesh, the edit still goes to the shared heights for the collision
+	if (!CanBuildRenderMesh())
 	{
-		return FBoxSphereBounds(CachedLocalBounds.TransformBy(LocalToWorld));
+		const UWorld* World = GetWorld();
+		const UHeightfieldDataSubsystem* DataSubsystem = World ? World->GetSubsystem<UHeightfieldDataSubsystem>() : nullptr;
+		const FHeightfieldDataPtr Data = SourceHeightData.IsValid() || !DataSubsystem ? SourceHeightData : DataSubsystem->FindHeightfieldData(HeightmapTexture);
+		if (Data.IsValid())
+		{
+			Data->EditHeights(Heights, StartRow, StartCol, NumRows, NumCols);
+		}
+		return;
 	}
-	return FBoxSphereBounds(LocalToWorld.GetLocation(), FVector::ZeroVector, 0.0f);
-}
 
-#if WITH_EDITOR
-void UHeightfieldMeshComponent::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
-{
-	Super::PostEditChangeProperty(PropertyChangedEvent);
+	// Only the first build has to land before there are heights to edit, later ones catch up with the edit
+	if (!Geometry.IsValid())
+	{
+		WaitForPendingBuild();
+	}
 
-	const FName PropertyName = PropertyChangedEvent.Property ?
-		PropertyChangedEvent.Property->GetFName() : NAME_None;
+	if (!Geometry.IsValid())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("HeightfieldMesh: No mesh to update"));
+		return;
+	}
 
-	if (PropertyName == GET_MEMBER_NAME_CHECKED(UHeightfieldMeshComponent, HeightmapTexture) ||
-		PropertyName == GET_MEMBER_NAME_CHECKED(UHeightfieldMeshComponent, HeightfieldScale) ||
-		PropertyName == GET_MEMBER_NAME_CHECKED(UHeightfieldMeshComponent, LODFactor))
+	if (!Geometry.HeightData->IsValidRegion(StartRow, StartCol, NumRows, NumCols))
 	{
-		RebuildMesh();
+		UE_LOG(LogTemp, Warning, TEXT("HeightfieldMesh: Update region (%d,%d) + (%d,%d) out of bounds (%d,%d)"),
+			StartRow, StartCol, NumRows, NumCols, Geometry.TextureHeight, Geometry.TextureWidth);
+		return;
 	}
+
+	// The mesh is patched from OnHeightDataChanged, along with every other user of the data
+	Geometry.HeightData->EditHeights(Heights, StartRow, StartCol, NumRows, NumCols);
 }
-#endif
 
-void UHeightfieldMeshComponent::RebuildMesh()
+void UHeightfieldMeshComponent::BindHeightData()
 {
-	Vertices.Empty();
-	Indices.Empty();
-	Normals.Empty();
-	UVs.Empty();
-	CachedHeights.Empty();
+	if (Geometry.HeightData.IsValid() && !BoundHeightData.IsValid())
+	{
+		BoundHeightData = Geometry.HeightData;
+		HeightDataChangedHandle = BoundHeightData->OnRegionChanged().AddUObject(this, &UHeightfieldMeshComponent::OnHeightDataChanged);
+	}
+}
 
-	if (!HeightmapTexture || !HeightmapTexture->GetPlatformData())
+void UHeightfieldMeshComponent::UnbindHeightData()
+{
+	if (BoundHeightData.IsValid())
 	{
-		MarkRenderStateDirty();
-		return;
+		BoundHeightData->OnRegionChanged().Remove(HeightDataChangedHandle);
+		BoundHeightData.Reset();
+		HeightDataChangedHandle.Reset();
 	}
+}
 
-	const FTexturePlatformData* PlatformData = HeightmapTexture->GetPlatformData();
-	if (PlatformData->Mips.Num() == 0 || PlatformData->PixelFormat != PF_B8G8R8A8)
+void UHeightfieldMeshComponent::OnHeightDataChanged(int32 StartRow, int32 StartCol, int32 NumRows, int32 NumCols)
+{
+	// A running rebuild works from a snapshot and catches up with the edit once it completes, see CompleteAsyncBuild
+	if (Geometry.IsValid() && Geometry.ClampRegion(StartRow, StartCol, NumRows, NumCols))
 	{
-		UE_LOG(LogTemp, Warning, TEXT("HeightfieldMesh: Invalid texture format"));
-		MarkRenderStateDirty();
-		return;
+		UpdateVerticesInRegion(StartRow, StartCol, NumRows, NumCols);
 	}
+}
 
-	const FTexture2DMipMap& Mip0 = PlatformData->Mips[0];
-	TextureWidth = Mip0.SizeX;
-	TextureHeight = Mip0.SizeY;
+bool FHeightfieldMeshGeometry::ClampRegion(int32& StartRow, int32& StartCol, int32& NumRows, int32& NumCols) const
+{
+	const int32 EndRow = FMath::Min(StartRow + NumRows, TextureHeight);
+	const int32 EndCol = FMath::Min(StartCol + NumCols, TextureWidth);
+	StartRow = FMath::Max(StartRow, 0);
+	StartCol = FMath::Max(StartCol, 0);
+	NumRows = EndRow - StartRow;
+	NumCols = EndCol - StartCol;
+	return NumRows > 0 && NumCols > 0;
+}
 
-	// Lock and read texture data
-	const uint8* PixelData = static_cast<const uint8*>(Mip0.BulkData.LockReadOnly());
-	if (!PixelData)
+void UHeightfieldMeshComponent::UpdateVerticesInRegion(int32 StartRow, int32 StartCol, int32 NumRows, int32 NumCols)
+{
+	// Adaptive triangulations depend on the heights themselves, so they can't be patched in place
+	if (Geometry.bAdaptiveTriangulation)
 	{
+		PendingRenderData = Geometry.BuildFromHeights();
+		UpdateBounds();
 		MarkRenderStateDirty();
 		return;
 	}
 
-	// Cache all heights
-	CachedHeights.SetNumUninitialized(TextureWidth * TextureHeight);
-	for (int32 i = 0; i < CachedHeights.Num(); ++i)
-	{
-		const int32 PixelOffset = i * 4;
-		const uint8 B = PixelData[PixelOffset + 0];
-		const uint8 G = PixelData[PixelOffset + 1];
-		CachedHeights[i] = (static_cast<uint16>(B) << 8) | static_cast<uint16>(G);
-	}
-
-	Mip0.BulkData.Unlock();
+	// Normals depend on the neighbouring texels, so grow the region by one texel
+	// and convert it to an (inclusive) range of grid vertices
+	const int32 MinVertX = FMath::Max(0, (StartCol - 1) / Geometry.MeshStepSize);
+	const int32 MinVertY = FMath::Max(0, (StartRow - 1) / Geometry.MeshStepSize);
+	const int32 MaxVertX = FMath::Min(Geometry.MeshVertsX - 1, FMath::DivideAndRoundUp(StartCol + NumCols, Geometry.MeshStepSize));
+	const int32 MaxVertY = FMath::Min(Geometry.MeshVertsY - 1, FMath::DivideAndRoundUp(StartRow + NumRows, Geometry.MeshStepSize));
 
-	// Generate mesh with LOD
-	const int32 StepSize = FMath::Max(1, LODFactor);
-	const int32 VertsX = (TextureWidth + StepSize - 1) / StepSize;
-	const int32 VertsY = (TextureHeight + StepSize - 1) / StepSize;
+	// Chunks share their border vertices, so a vertex on a border belongs to both chunks
+	const int32 MinChunkX = FMath::Max(0, (MinVertX - 1) / Geometry.MeshChunkSize);
+	const int32 MinChunkY = FMath::Max(0, (MinVertY - 1) / Geometry.MeshChunkSize);
+	const int32 MaxChunkX = FMath::Min(Geometry.NumChunksX - 1, MaxVertX / Geometry.MeshChunkSize);
+	const int32 MaxChunkY = FMath::Min(Geometry.NumChunksY - 1, MaxVertY / Geometry.MeshChunkSize);
 
-	// Reserve memory
-	Vertices.Reserve(VertsX * VertsY);
-	Normals.Reserve(VertsX * VertsY);
-	UVs.Reserve(VertsX * VertsY);
-	Indices.Reserve((VertsX - 1) * (VertsY - 1) * 6);
+	TUniquePtr<FHeightfieldMeshRegionUpdate> Update = MakeUnique<FHeightfieldMeshRegionUpdate>();
+	const int32 MaxUpdatedVertices = (MaxVertX - MinVertX + 3) * (MaxVertY - MinVertY + 3);
+	Update->Positions.Reserve(MaxUpdatedVertices);
+	Update->Normals.Reserve(MaxUpdatedVertices);
 
-	// Generate vertices
-	float MinZ = MAX_FLT, MaxZ = -MAX_FLT;
-	for (int32 Y = 0; Y < VertsY; ++Y)
+	for (int32 ChunkY = MinChunkY; ChunkY <= MaxChunkY; ++ChunkY)
 	{
-		for (int32 X = 0; X < VertsX; ++X)
+		for (int32 ChunkX = MinChunkX; ChunkX <= MaxChunkX; ++ChunkX)
 		{
-			const int32 TexX = FMath::Min(X * StepSize, TextureWidth - 1);
-			const int32 TexY = FMath::Min(Y * StepSize, TextureHeight - 1);
+			const int32 ChunkIndex = ChunkY * Geometry.NumChunksX + ChunkX;
+			FHeightfieldMeshChunk& Chunk = Geometry.Chunks[ChunkIndex];
+
+			// Overlap of the dirty vertex range with this chunk
+			const int32 X0 = FMath::Max(MinVertX, Chunk.GridX);
+			const int32 Y0 = FMath::Max(MinVertY, Chunk.GridY);
+			const int32 X1 = FMath::Min(MaxVertX, Chunk.GridX + Chunk.NumVertsX - 1);
+			const int32 Y1 = FMath::Min(MaxVertY, Chunk.GridY + Chunk.NumVertsY - 1);
+			if (X0 > X1 || Y0 > Y1)
+			{
+				continue;
+			}
+
+			const FBox OldBounds = Chunk.LocalBounds;
 
-			const float Height = GetHeightAt(TexX, TexY);
-			const FVector Position(
-				TexX * HeightfieldScale.X,
-				TexY * HeightfieldScale.Y,
-				Height
-			);
+			// One run per chunk, so the render thread locks each buffer once per chunk. The run starts at the first
+			// dirty grid vertex and ends past the last dirty skirt vertex, or the last dirty grid vertex without skirt
+			// edits; the clean vertices between are written too, with the values they already have
+			const int32 LastX = Chunk.GridX + Chunk.NumVertsX - 1;
+			const int32 LastY = Chunk.GridY + Chunk.NumVertsY - 1;
+			const int32 RunStart = Chunk.FirstVertex + (Y0 - Chunk.GridY) * Chunk.NumVertsX + (X0 - Chunk.GridX);
+			int32 RunEnd = Chunk.FirstVertex + (Y1 - Chunk.GridY) * Chunk.NumVertsX + (X1 - Chunk.GridX) + 1;
+			if (Y0 == Chunk.GridY)
+			{
+				RunEnd = FMath::Max(RunEnd, Chunk.GetSkirtVertex(FHeightfieldMeshChunk::EEdge::Top, X1 - Chunk.GridX) + 1);
+			}
+			if (Y1 == LastY)
+			{
+				RunEnd = FMath::Max(RunEnd, Chunk.GetSkirtVertex(FHeightfieldMeshChunk::EEdge::Bottom, X1 - Chunk.GridX) + 1);
+			}
+			if (X0 == Chunk.GridX)
+			{
+				RunEnd = FMath::Max(RunEnd, Chunk.GetSkirtVertex(FHeightfieldMeshChunk::EEdge::Left, Y1 - Chunk.GridY) + 1);
+			}
+			if (X1 == LastX)
+			{
+				RunEnd = FMath::Max(RunEnd, Chunk.GetSkirtVertex(FHeightfieldMeshChunk::EEdge::Right, Y1 - Chunk.GridY) + 1);
+			}
+			Update->Runs.Add({ RunStart, RunEnd - RunStart });
 
-			Vertices.Add(Position);
-			Normals.Add(CalculateNormalAt(TexX, TexY));
-			UVs.Add(FVector2D(
-				static_cast<float>(TexX) / (TextureWidth - 1),
-				static_cast<float>(TexY) / (TextureHeight - 1)
-			));
+			for (int32 VertexIndex = RunStart; VertexIndex < RunEnd; ++VertexIndex)
+			{
+				// Skirt vertices follow the edge vertices they hang from
+				bool bSkirt = false;
+				const FIntPoint GridVertex = Chunk.GetGridVertex(VertexIndex, bSkirt);
+				const FVector Position = Geometry.GetGridVertexPosition(GridVertex.X, GridVertex.Y) - FVector(0, 0, bSkirt ? Geometry.SkirtDepth : 0.0f);
+				const int32 TexX = FMath::Min(GridVertex.X * Geometry.MeshStepSize, Geometry.TextureWidth - 1);
+				const int32 TexY = FMath::Min(GridVertex.Y * Geometry.MeshStepSize, Geometry.TextureHeight - 1);
+				Update->Positions.Add(FVector3f(Position));
+				Update->Normals.Add(FVector3f(Geometry.CalculateNormalAt(TexX, TexY)));
+			}
 
-			MinZ = FMath::Min(MinZ, Height);
-			MaxZ = FMath::Max(MaxZ, Height);
+			// Bounds follow the edit both ways, so flattened terrain gets tighter culling bounds
+			Chunk.LocalBounds = Geometry.CalculateChunkBounds(Chunk);
+			if (!OldBounds.Equals(Chunk.LocalBounds))
+			{
+				Update->ChunkBounds.Add({ ChunkIndex, Chunk.LocalBounds });
+			}
 		}
 	}
 
-	// Generate indices (two triangles per quad)
-	for (int32 Y = 0; Y < VertsY - 1; ++Y)
+	const FBox NewLocalBounds = Geometry.CalculateMeshBounds();
+	if (!NewLocalBounds.Equals(Geometry.CachedLocalBounds))
 	{
-		for (int32 X = 0; X < VertsX - 1; ++X)
-		{
-			const int32 TopLeft = Y * VertsX + X;
-			const int32 TopRight = TopLeft + 1;
-			const int32 BottomLeft = TopLeft + VertsX;
-			const int32 BottomRight = BottomLeft + 1;
-
-			// First triangle
-			Indices.Add(TopLeft);
-			Indices.Add(BottomLeft);
-			Indices.Add(TopRight);
-
-			// Second triangle
-			Indices.Add(TopRight);
-			Indices.Add(BottomLeft);
-			Indices.Add(BottomRight);
-		}
+		Geometry.CachedLocalBounds = NewLocalBounds;
+		UpdateBounds();
+		MarkRenderTransformDirty();
 	}
 
-	// Update cached bounds
-	CachedLocalBounds = FBox(
-		FVector(0, 0, MinZ),
-		FVector(TextureWidth * HeightfieldScale.X, TextureHeight * HeightfieldScale.Y, MaxZ)
-	);
+	if (Update->Runs.Num() == 0)
+	{
+		return;
+	}
 
-	UE_LOG(LogTemp, Log, TEXT("HeightfieldMesh: Built mesh with %d vertices, %d triangles"),
-		Vertices.Num(), Indices.Num() / 3);
+	// After a rebuild the current proxy still has the previous layout until the render state is recreated.
+	// The next proxy is made from the pending render data, or from the heights if there is none, so the edit goes there
+	if (PendingRenderData.IsValid())
+	{
+		ApplyRegionUpdate(*Update, *PendingRenderData);
+		return;
+	}
 
-	UpdateBounds();
-	MarkRenderStateDirty();
-}
+	FHeightfieldMeshSceneProxy* HeightfieldProxy = static_cast<FHeightfieldMeshSceneProxy*>(SceneProxy);
+	if (!HeightfieldProxy || IsRenderStateDirty())
+	{
+		return;
+	}
 
-void UHeightfieldMeshComponent::UpdateMeshRegion(int32 StartRow, int32 StartCol, int32 NumRows, int32 NumCols)
-{
-	// For now, just rebuild the whole mesh
-	// TODO: Implement partial update for better performance
-	RebuildMesh();
+	// The proxy is deleted on the render thread by a command the scene enqueues once the component lets go of
+	// it, always after this one, so it is still alive when the update runs. The update is freed with the command
+	ENQUEUE_RENDER_COMMAND(UpdateHeightfieldMeshRegion)(
+		[HeightfieldProxy, Update = MoveTemp(Update)](FRHICommandListImmediate& RHICmdList)
+		{
+			HeightfieldProxy->UpdateRegion_RenderThread(RHICmdList, *Update);
+		});
 }
 
 void UHeightfieldMeshComponent::GetMeshData(
@@ -355,34 +2091,95 @@ void UHeightfieldMeshComponent::GetMeshData(
 	TArray<FVector>& OutNormals,
 	TArray<FVector2D>& OutUVs) const
 {
-	OutVertices = Vertices;
-	OutIndices = Indices;
-	OutNormals = Normals;
-	OutUVs = UVs;
+	OutVertices.Reset();
+	OutIndices.Reset();
+	OutNormals.Reset();
+	OutUVs.Reset();
+
+	if (Geometry.Chunks.Num() == 0)
+	{
+		return;
+	}
+
+	// The component keeps no mesh copy, generate one on request
+	const FHeightfieldMeshRenderDataPtr RenderData = Geometry.GenerateRenderData(nullptr);
+
+	OutVertices.Reserve(RenderData->Positions.Num());
+	OutNormals.Reserve(RenderData->Positions.Num());
+	OutUVs.Reserve(RenderData->Positions.Num());
+	for (int32 i = 0; i < RenderData->Positions.Num(); ++i)
+	{
+		OutVertices.Add(FVector(RenderData->Positions[i]));
+		OutNormals.Add(FVector(RenderData->TangentBasis[i * 2 + 1].ToFVector3f()));
+		OutUVs.Add(FVector2D(RenderData->GetTexCoord(i)));
+	}
+
+	// Indices are stored relative to their chunk
+	OutIndices.SetNumUninitialized(RenderData->GetNumIndices());
+	for (const FHeightfieldMeshChunk& Chunk : Geometry.Chunks)
+	{
+		for (const FHeightfieldMeshChunkLOD& LOD : Chunk.LODs)
+		{
+			for (int32 i = LOD.FirstIndex; i < LOD.FirstIndex + LOD.NumTriangles * 3; ++i)
+			{
+				const uint32 Index = RenderData->Uses16BitIndices() ? RenderData->Indices16[i] : RenderData->Indices[i];
+				OutIndices[i] = Chunk.FirstVertex + Index;
+			}
+		}
+	}
 }
 
-float UHeightfieldMeshComponent::GetHeightAt(int32 X, int32 Y) const
+float FHeightfieldMeshGeometry::GetHeightAt(int32 X, int32 Y) const
 {
 	if (X < 0 || X >= TextureWidth || Y < 0 || Y >= TextureHeight)
 	{
+		// Pieces of a larger heightfield know the samples of their neighbours along the border
+		if (HeightData->HasApron() && X >= -1 && X <= TextureWidth && Y >= -1 && Y <= TextureHeight)
+		{
+			return HeightFromRaw(HeightData->GetApronHeightAt(X, Y));
+		}
 		return 0.0f;
 	}
 
-	const int32 Index = Y * TextureWidth + X;
-	const uint16 HeightValue = CachedHeights[Index];
+	return HeightFromRaw(HeightData->GetHeightAt(X, Y));
+}
 
+float FHeightfieldMeshGeometry::HeightFromRaw(uint16 HeightValue) const
+{
 	// Convert from uint16 to world height
 	// Same formula as collision component
 	return (static_cast<float>(HeightValue) - 32768.0f) * HeightfieldScale.Z * MESH_HEIGHTFIELD_ZSCALE;
 }
 
-FVector UHeightfieldMeshComponent::CalculateNormalAt(int32 X, int32 Y) const
+FVector FHeightfieldMeshGeometry::CalculateNormalAt(int32 X, int32 Y) const
 {
-	// Sample neighboring heights for normal calculation
-	const float Left = GetHeightAt(X - 1, Y);
-	const float Right = GetHeightAt(X + 1, Y);
-	const float Up = GetHeightAt(X, Y - 1);
-	const float Down = GetHeightAt(X, Y + 1);
+	float Left, Right, Up, Down;
+
+	if (X > 0 && X < TextureWidth - 1 && Y > 0 && Y < TextureHeight - 1 && !HeightData->IsCompressed())
+	{
+		// Interior fast path, all four neighbours are inside the texture
+		const uint16* Center = &HeightData->GetHeights().GetData()[Y * TextureWidth + X];
+		Left = HeightFromRaw(Center[-1]);
+		Right = HeightFromRaw(Center[1]);
+		Up = HeightFromRaw(Center[-TextureWidth]);
+		Down = HeightFromRaw(Center[TextureWidth]);
+	}
+	else if (X > 0 && X < TextureWidth - 1 && Y > 0 && Y < TextureHeight - 1)
+	{
+		// Compressed heights, still no bounds checks needed
+		Left = HeightFromRaw(HeightData->GetHeightAt(X - 1, Y));
+		Right = HeightFromRaw(HeightData->GetHeightAt(X + 1, Y));
+		Up = HeightFromRaw(HeightData->GetHeightAt(X, Y - 1));
+		Down = HeightFromRaw(HeightData->GetHeightAt(X, Y + 1));
+	}
+	else
+	{
+		// Sample neighboring heights for normal calculation
+		Left = GetHeightAt(X - 1, Y);
+		Right = GetHeightAt(X + 1, Y);
+		Up = GetHeightAt(X, Y - 1);
+		Down = GetHeightAt(X, Y + 1);
+	}
 
 	// Calculate normal from height differences
 	const FVector Normal(
@@ -4,16 +4,273 @@
 
 #include "CoreMinimal.h"
 #include "Components/MeshComponent.h"
+#include "PackedNormal.h"
+#include "HeightfieldData.h"
 #include "HeightfieldMeshComponent.generated.h"
 
 class UTexture2D;
 class UMaterialInterface;
+class UHeightfieldMeshComponent;
+
+/** Index range of one detail level of a chunk */
+struct FHeightfieldMeshChunkLOD
+{
+	int32 FirstIndex = 0;
+	int32 NumTriangles = 0;
+
+	friend FArchive& operator<<(FArchive& Ar, FHeightfieldMeshChunkLOD& LOD)
+	{
+		return Ar << LOD.FirstIndex << LOD.NumTriangles;
+	}
+};
+
+/**
+ * A rectangular block of terrain quads that the scene proxy culls and LODs as a unit.
+ * Each chunk owns a contiguous range of vertices (border vertices are
+ * duplicated between neighbours), followed by its skirt vertices, and
+ * a contiguous index range per detail level.
+ */
+struct FHeightfieldMeshChunk
+{
+	/** First vertex of the chunk in the chunk-major vertex arrays (grid vertices, then skirt vertices) */
+	int32 FirstVertex = 0;
+	int32 NumVertices = 0;
+
+	/** Index ranges per detail level, LOD 0 = full resolution */
+	TArray<FHeightfieldMeshChunkLOD, TInlineAllocator<6>> LODs;
+
+	/** Position of the chunk's first vertex in the full vertex grid, and its vertex dimensions */
+	int32 GridX = 0;
+	int32 GridY = 0;
+	int32 NumVertsX = 0;
+	int32 NumVertsY = 0;
+
+	/** Local-space bounds of the chunk's vertices */
+	FBox LocalBounds = FBox(ForceInit);
+
+	/** Chunk edges, in the order their skirt vertices are stored */
+	enum class EEdge : uint8 { Top, Bottom, Left, Right };
+
+	/** Vertex index of the skirt vertex below grid vertex Offset along the given edge */
+	int32 GetSkirtVertex(EEdge Edge, int32 Offset) const
+	{
+		const int32 SkirtBase = FirstVertex + NumVertsX * NumVertsY;
+		switch (Edge)
+		{
+		case EEdge::Top:    return SkirtBase + Offset;
+		case EEdge::Bottom: return SkirtBase + NumVertsX + Offset;
+		case EEdge::Left:   return SkirtBase + 2 * NumVertsX + Offset;
+		default:            return SkirtBase + 2 * NumVertsX + NumVertsY + Offset;
+		}
+	}
+
+	/** Grid vertex that a vertex of the chunk sits on, or hangs below if it is a skirt vertex */
+	FIntPoint GetGridVertex(int32 VertexIndex, bool& bOutSkirt) const
+	{
+		int32 Offset = VertexIndex - FirstVertex;
+		const int32 NumGridVertices = NumVertsX * NumVertsY;
+		bOutSkirt = Offset >= NumGridVertices;
+		if (!bOutSkirt)
+		{
+			return FIntPoint(GridX + Offset % NumVertsX, GridY + Offset / NumVertsX);
+		}
+
+		Offset -= NumGridVertices;
+		if (Offset < NumVertsX)
+		{
+			return FIntPoint(GridX + Offset, GridY);
+		}
+		Offset -= NumVertsX;
+		if (Offset < NumVertsX)
+		{
+			return FIntPoint(GridX + Offset, GridY + NumVertsY - 1);
+		}
+		Offset -= NumVertsX;
+		if (Offset < NumVertsY)
+		{
+			return FIntPoint(GridX, GridY + Offset);
+		}
+		return FIntPoint(GridX + NumVertsX - 1, GridY + Offset - NumVertsY);
+	}
+
+	friend FArchive& operator<<(FArchive& Ar, FHeightfieldMeshChunk& Chunk)
+	{
+		Ar << Chunk.FirstVertex << Chunk.NumVertices << Chunk.LODs;
+		Ar << Chunk.GridX << Chunk.GridY << Chunk.NumVertsX << Chunk.NumVertsY;
+		return Ar << Chunk.LocalBounds;
+	}
+};
+
+/** Texture coordinate stored as two 16-bit normalized values (compact vertex format) */
+struct FHeightfieldCompactTexCoord
+{
+	uint16 U = 0;
+	uint16 V = 0;
+
+	friend FArchive& operator<<(FArchive& Ar, FHeightfieldCompactTexCoord& TexCoord)
+	{
+		return Ar << TexCoord.U << TexCoord.V;
+	}
+};
+
+/**
+ * Render-ready vertex and index streams of a heightfield mesh.
+ * Built once by the component and handed to the scene proxy by pointer;
+ * the proxy uploads it to the GPU and releases it right away.
+ */
+struct FHeightfieldMeshRenderData
+{
+	TArray<FVector3f> Positions;
+
+	/** TangentX, TangentZ pair per vertex */
+	TArray<FPackedNormal> TangentBasis;
+
+	/** Full precision texture coordinates, empty when the compact vertex format is used */
+	TArray<FVector2f> TexCoords;
+
+	/** 16-bit normalized texture coordinates, only filled for the compact vertex format */
+	TArray<FHeightfieldCompactTexCoord> CompactTexCoords;
+
+	/**
+	 * Triangle indices relative to the first vertex of their chunk, in 32 or 16 bits.
+	 * Only one of the two arrays is filled.
+	 */
+	TArray<uint32> Indices;
+	TArray<uint16> Indices16;
+
+	bool UsesCompactVertexFormat() const { return CompactTexCoords.Num() > 0; }
+
+	bool Uses16BitIndices() const { return Indices16.Num() > 0; }
+
+	int32 GetNumIndices() const { return Uses16BitIndices() ? Indices16.Num() : Indices.Num(); }
+
+	/** Texture coordinate of a vertex, whichever format it is stored in */
+	FVector2f GetTexCoord(int32 VertexIndex) const
+	{
+		if (UsesCompactVertexFormat())
+		{
+			const FHeightfieldCompactTexCoord& TexCoord = CompactTexCoords[VertexIndex];
+			return FVector2f(TexCoord.U / 65535.0f, TexCoord.V / 65535.0f);
+		}
+		return TexCoords[VertexIndex];
+	}
+
+	friend FArchive& operator<<(FArchive& Ar, FHeightfieldMeshRenderData& RenderData);
+};
+
+using FHeightfieldMeshRenderDataPtr = TSharedPtr<FHeightfieldMeshRenderData, ESPMode::ThreadSafe>;
+
+/**
+ * Decoded heights and chunk layout a heightfield mesh is generated from.
+ * Carries its own copy of the component settings it is built with, so it can be
+ * built on a worker thread while the component keeps rendering the previous one.
+ */
+struct FHeightfieldMeshGeometry
+{
+	/** Component settings this geometry is built with */
+	FGuid SourceTextureId;
+	FVector HeightfieldScale = FVector(100.0f, 100.0f, 100.0f);
+	int32 LODFactor = 1;
+	int32 ChunkSize = 64;
+	int32 NumChunkLODs = 4;
+	float SkirtDepth = 200.0f;
+	bool bUseCompactVertexFormat = false;
+	bool bOptimizeIndexOrder = true;
+	bool bAdaptiveTriangulation = false;
+	float AdaptiveMaxError = 10.0f;
+
+	/** Decoded heights, shared with other components using the same heightmap */
+	FHeightfieldDataPtr HeightData;
+	int32 TextureWidth = 0;
+	int32 TextureHeight = 0;
+
+	/** Chunk layout of the mesh */
+	TArray<FHeightfieldMeshChunk> Chunks;
+
+	/** Layout of the generated vertex grid */
+	int32 MeshStepSize = 1;
+	int32 MeshVertsX = 0;
+	int32 MeshVertsY = 0;
+	int32 MeshChunkSize = 1;
+	int32 NumChunksX = 0;
+	int32 NumChunksY = 0;
+	int32 MeshNumVertices = 0;
+	int32 MeshNumIndices = 0;
+	bool bMeshHasSkirts = false;
+
+	/** True if every chunk is small enough for 16-bit chunk-relative indices */
+	bool bUse16BitIndices = false;
+
+	/** Local-space bounds of the whole mesh */
+	FBox CachedLocalBounds = FBox(ForceInit);
+
+	/** True once heights are decoded and chunks laid out */
+	bool IsValid() const
+	{
+		return Chunks.Num() > 0 && HeightData.IsValid() &&
+			HeightData->GetWidth() == TextureWidth && HeightData->GetHeight() == TextureHeight;
+	}
+
+	/**
+	 * Lays out the chunks for the given heights and generates the render data.
+	 * Off the game thread, pass heights nobody edits meanwhile (a fresh decode or a snapshot).
+	 * Returns null if the heightmap can't be turned into a mesh.
+	 */
+	FHeightfieldMeshRenderDataPtr Build(const FHeightfieldDataPtr& InHeightData);
+
+	/** Lays out the chunks and generates the render data from the already decoded heights. Off the game thread, hold the data's read lock */
+	FHeightfieldMeshRenderDataPtr BuildFromHeights();
+
+	/**
+	 * Computes the chunk layout (vertex and index ranges) for the current heights and settings.
+	 * Adaptive chunks are triangulated here to size their index ranges, so the layout has to be
+	 * recomputed whenever their heights change.
+	 */
+	bool LayoutChunks();
+
+	/** Generates the render data for the current chunk layout from the decoded heights. Off the game thread, hold the data's read lock */
+	FHeightfieldMeshRenderDataPtr GenerateRenderData(TArray<FBox>* OutChunkBounds) const;
+
+	/** Clamps a texel region to the heightmap, returns false if nothing is left */
+	bool ClampRegion(int32& StartRow, int32& StartCol, int32& NumRows, int32& NumCols) const;
+
+	/** Extract height from the cached heights at given coordinates */
+	float GetHeightAt(int32 X, int32 Y) const;
+
+	/** Convert a raw 16-bit height sample to local-space height */
+	float HeightFromRaw(uint16 HeightValue) const;
+
+	/** Calculate normal at given coordinates */
+	FVector CalculateNormalAt(int32 X, int32 Y) const;
+
+	/** Local-space position of a vertex of the (LOD-decimated) vertex grid */
+	FVector GetGridVertexPosition(int32 X, int32 Y) const;
+
+	/** Local bounds of a chunk including its skirts, from the min/max pyramid of the heights it covers */
+	FBox CalculateChunkBounds(const FHeightfieldMeshChunk& Chunk) const;
+
+	/** Local bounds of the whole mesh including skirts, from the root of the min/max pyramid */
+	FBox CalculateMeshBounds() const;
+
+	/** Local-space Z range of a raw height range, lowered by the skirt depth if the mesh has skirts */
+	void GetLocalZRange(const FHeightfieldHeightRange& Range, float& OutMinZ, float& OutMaxZ) const;
+
+	friend FArchive& operator<<(FArchive& Ar, FHeightfieldMeshGeometry& Geometry);
+};
+
+/** State of a background mesh build, shared between the build task and the component */
+struct FHeightfieldMeshAsyncBuild;
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FHeightfieldMeshBuiltDelegate, UHeightfieldMeshComponent*, Component);
 
 /**
  * A mesh component that renders terrain from a heightmap texture.
  * Designed to work alongside UHeightfieldMeshCollisionComponent for
  * synchronized visual and collision representation.
  *
+ * Without a renderer (dedicated server, -nullrhi) the component builds and keeps no mesh;
+ * raw edits still go to the shared heights, so the collision follows them.
+ *
  * Texture format (same as collision component):
  * - B + G channels = 16-bit height (B = high byte, G = low byte)
  * - R channel = material index (for material layers, optional)
@@ -26,6 +283,11 @@ class TESTVEHICLEGAME_API UHeightfieldMeshComponent : public UMeshComponent
 public:
 	UHeightfieldMeshComponent(const FObjectInitializer& ObjectInitializer);
 
+	//~ Begin UObject Interface
+	virtual void Serialize(FArchive& Ar) override;
+	virtual void PostLoad() override;
+	//~ End UObject Interface
+
 	//~ Begin UPrimitiveComponent Interface
 	virtual FPrimitiveSceneProxy* CreateSceneProxy() override;
 	virtual int32 GetNumMaterials() const override;
@@ -34,15 +296,70 @@ public:
 	virtual FBoxSphereBounds CalcBounds(const FTransform& LocalToWorld) const override;
 	//~ End UPrimitiveComponent Interface
 
-	/** Rebuilds the mesh from the heightmap texture */
+	//~ Begin UActorComponent Interface
+	virtual void OnRegister() override;
+	virtual void OnUnregister() override;
+	//~ End UActorComponent Interface
+
+	/**
+	 * Rebuilds the mesh from the heightmap texture.
+	 * With bBuildAsync the build runs in the background and the current mesh keeps
+	 * rendering until the new one replaces it; OnMeshBuilt fires once it is in place.
+	 */
 	UFUNCTION(BlueprintCallable, Category="Mesh")
 	void RebuildMesh();
 
-	/** Updates a region of the mesh (for runtime deformation) */
+	/** Blocks until a pending background build has finished and applies its result */
+	UFUNCTION(BlueprintCallable, Category="Mesh")
+	void WaitForPendingBuild();
+
+	/** True while a background build is running */
+	UFUNCTION(BlueprintPure, Category="Mesh")
+	bool IsBuildPending() const;
+
+	/** Called on the game thread whenever a rebuild has been applied, including rebuilds that produced no mesh */
+	UPROPERTY(BlueprintAssignable, Category="Mesh")
+	FHeightfieldMeshBuiltDelegate OnMeshBuilt;
+
+	/**
+	 * Updates a region of the mesh (for runtime deformation).
+	 * Re-reads only the given texels from the heightmap texture and pushes the affected
+	 * vertices to the existing scene proxy, without recreating render state.
+	 * The texels are re-read into the shared heightfield data, so a collision component
+	 * using the same heightmap is updated as well.
+	 *
+	 * @param StartRow - Starting row index (Y)
+	 * @param StartCol - Starting column index (X)
+	 * @param NumRows - Number of rows to update
+	 * @param NumCols - Number of columns to update
+	 */
 	UFUNCTION(BlueprintCallable, Category="Mesh")
 	void UpdateMeshRegion(int32 StartRow, int32 StartCol, int32 NumRows, int32 NumCols);
 
-	/** Get mesh vertex/index data for external use */
+	/**
+	 * Same as UpdateMeshRegion, but takes the new uint16 heights for the region directly
+	 * (row-major order, same format as UHeightfieldMeshCollisionComponent::UpdateHeightfieldRegionRaw).
+	 * The heights are written to the shared heightfield data, which updates every component using it.
+	 */
+	void UpdateMeshRegionRaw(TArrayView<const uint16> Heights, int32 StartRow, int32 StartCol, int32 NumRows, int32 NumCols);
+
+	/**
+	 * Builds the mesh from the given heightfield data instead of the heightmap texture,
+	 * e.g. for a tile of a streamed terrain. Null goes back to the texture.
+	 */
+	void SetHeightData(const FHeightfieldDataPtr& NewHeightData);
+
+	/** Sample spacing (X, Y) and height scale (Z) */
+	const FVector& GetHeightfieldScale() const { return HeightfieldScale; }
+
+	/** Whether rebuilds run on a background task, takes effect with the next rebuild */
+	void SetBuildAsync(bool bInBuildAsync) { bBuildAsync = bInBuildAsync; }
+
+	/**
+	 * Get mesh vertex/index data for external use.
+	 * Vertices are laid out chunk by chunk (see FHeightfieldMeshChunk), row-major within a chunk.
+	 * The component keeps no copy of the mesh, so this generates it from the cached heights.
+	 */
 	void GetMeshData(TArray<FVector>& OutVertices, TArray<uint32>& OutIndices, TArray<FVector>& OutNormals, TArray<FVector2D>& OutUVs) const;
 
 protected:
@@ -62,31 +379,119 @@ protected:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Heightfield", meta=(ClampMin="1", ClampMax="16"))
 	int32 LODFactor = 1;
 
+	/** Number of quads along each side of a render chunk. Chunks are frustum culled individually. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Heightfield", meta=(ClampMin="8", ClampMax="256"))
+	int32 ChunkSize = 64;
+
+	/** Number of distance-based detail levels per chunk. Each level halves the vertex density of the previous one. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Heightfield|LOD", meta=(ClampMin="1", ClampMax="6"))
+	int32 NumChunkLODs = 4;
+
+	/** Distance from the view within which chunks render at full detail. Each further level covers twice the distance. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Heightfield|LOD", meta=(ClampMin="1.0"))
+	float LOD0Distance = 10000.0f;
+
+	/** Depth of the skirts below chunk borders that hide cracks between neighbouring chunks at different detail levels */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Heightfield|LOD", meta=(ClampMin="0.0"))
+	float SkirtDepth = 200.0f;
+
+	/**
+	 * Store texture coordinates as 16-bit normalized values instead of 32-bit floats.
+	 * Cuts 4 bytes per vertex from the render data and the GPU vertex buffers,
+	 * and stays well below a texel of error for heightmaps up to 16k.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Heightfield|Rendering")
+	bool bUseCompactVertexFormat = false;
+
+	/**
+	 * Order the triangles of each chunk along a Z-order curve instead of row by row,
+	 * so neighbouring triangles reuse vertices from the GPU's post-transform cache.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Heightfield|Rendering")
+	bool bOptimizeIndexOrder = true;
+
+	/**
+	 * Draw through mesh draw commands cached when the component is added to the scene, instead of
+	 * building the mesh batch every frame. Saves the per-frame batch setup, but culling and the detail
+	 * level then apply to the whole component rather than per chunk: a large terrain is drawn entirely
+	 * at the detail level of its nearest point, so with the camera over it everything is drawn at full
+	 * detail. Only worth it for components of a few chunks, such as streamed tiles.
+	 * The per-frame path is still used for a few frames after every edit.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Heightfield|Rendering")
+	bool bCacheDrawCommands = false;
+
+	/**
+	 * Triangulate chunks adaptively (right-triangulated irregular network) instead of with a uniform grid,
+	 * so flat areas use far fewer triangles. Chunk borders keep every vertex, which keeps the mesh watertight
+	 * and on the collision grid there. Needs a power of two ChunkSize; chunks that are not full squares stay uniform.
+	 * Height edits re-triangulate the whole mesh in this mode.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Heightfield|Adaptive")
+	bool bAdaptiveTriangulation = false;
+
+	/** Largest vertical deviation from the heightmap allowed at full detail, doubled for each further detail level */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Heightfield|Adaptive", meta=(ClampMin="0.0", EditCondition="bAdaptiveTriangulation"))
+	float AdaptiveMaxError = 10.0f;
+
+	/** Rebuild the mesh on a background task instead of stalling the game thread */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Heightfield")
+	bool bBuildAsync = false;
+
 #if WITH_EDITOR
 	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
 #endif
 
 private:
-	/** Extract height from texture at given coordinates */
-	float GetHeightAt(int32 X, int32 Y) const;
+	/** Copies the current settings into a geometry that is about to be built */
+	void CopySettingsTo(FHeightfieldMeshGeometry& OutGeometry) const;
 
-	/** Calculate normal at given coordinates */
-	FVector CalculateNormalAt(int32 X, int32 Y) const;
+	/** True if the geometry was built from the current texture content and settings. Cooked builds only compare the settings,
+	 *  the texture source is stripped there and the mesh is cooked together with the texture */
+	bool IsBuiltWithCurrentSettings(const FHeightfieldMeshGeometry& InGeometry) const;
 
-	/** Cached mesh data */
-	TArray<FVector> Vertices;
-	TArray<uint32> Indices;
-	TArray<FVector> Normals;
-	TArray<FVector2D> UVs;
-	TArray<FColor> VertexColors;
+	/** Builds geometry and render data from the current texture and settings on the calling thread */
+	FHeightfieldMeshRenderDataPtr BuildGeometry(FHeightfieldMeshGeometry& OutGeometry) const;
 
-	/** Cached texture data for fast access */
-	TArray<uint16> CachedHeights;
-	int32 TextureWidth = 0;
-	int32 TextureHeight = 0;
+	/** Launches a background build of the mesh, NumStaleRestarts counts the builds before it that edits made stale */
+	void RebuildMeshAsync(int32 NumStaleRestarts = 0);
+
+	/**
+	 * Applies a finished background build, unless it was superseded. A build the heights were edited under
+	 * is started again if bCanRestart, a few times at most, else applied with the edited region patched on top.
+	 */
+	void CompleteAsyncBuild(const TSharedPtr<FHeightfieldMeshAsyncBuild, ESPMode::ThreadSafe>& Build, bool bCanRestart = true);
+
+	/** Makes a newly built geometry current and recreates the render state */
+	void ApplyBuild(FHeightfieldMeshGeometry&& NewGeometry, FHeightfieldMeshRenderDataPtr NewRenderData);
+
+	/** Regenerates vertices affected by a change of the given texels and sends them to the scene proxy */
+	void UpdateVerticesInRegion(int32 StartRow, int32 StartCol, int32 NumRows, int32 NumCols);
+
+	/** Starts listening for edits of the heightfield data the geometry is built from */
+	void BindHeightData();
+
+	/** Stops listening for edits of the heightfield data */
+	void UnbindHeightData();
+
+	/** Called when a region of the shared heightfield data was edited */
+	void OnHeightDataChanged(int32 StartRow, int32 StartCol, int32 NumRows, int32 NumCols);
+
+	/** Heights set with SetHeightData, used instead of the texture */
+	FHeightfieldDataPtr SourceHeightData;
+
+	/** Heights and chunk layout of the current mesh */
+	FHeightfieldMeshGeometry Geometry;
+
+	/** Render data waiting to be adopted by the next scene proxy */
+	FHeightfieldMeshRenderDataPtr PendingRenderData;
+
+	/** Background build in flight, if any */
+	TSharedPtr<FHeightfieldMeshAsyncBuild, ESPMode::ThreadSafe> PendingBuild;
 
-	/** Cached bounds */
-	FBox CachedLocalBounds;
+	/** Heightfield data the edit listener is registered with */
+	FHeightfieldDataPtr BoundHeightData;
+	FDelegateHandle HeightDataChangedHandle;
 
 	friend class FHeightfieldMeshSceneProxy;
 };
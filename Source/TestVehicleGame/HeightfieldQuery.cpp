@@ -0,0 +1,671 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "HeightfieldQuery.h"
+#include "HeightfieldMeshCollisionComponent.h"
+#include "Engine/World.h"
+#include "Algo/Sort.h"
+#include "Async/ParallelFor.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/ScopeRWLock.h"
+#include "UObject/UObjectIterator.h"
+
+// Same Z scale as the heightfield components
+static constexpr double QUERY_HEIGHTFIELD_ZSCALE = 1.0 / 128.0;
+
+/** Time at which the segment Start + Time * Dir enters a box, false if it misses the box before MaxTime */
+static bool IntersectSegmentBox(const FVector& Start, const FVector& Dir, const FBox& Box, double MaxTime, double& OutEnterTime)
+{
+	double EnterTime = 0.0;
+	double ExitTime = MaxTime;
+	for (int32 Axis = 0; Axis < 3; ++Axis)
+	{
+		if (FMath::Abs(Dir[Axis]) < UE_DOUBLE_SMALL_NUMBER)
+		{
+			if (Start[Axis] < Box.Min[Axis] || Start[Axis] > Box.Max[Axis])
+			{
+				return false;
+			}
+			continue;
+		}
+
+		double T0 = (Box.Min[Axis] - Start[Axis]) / Dir[Axis];
+		double T1 = (Box.Max[Axis] - Start[Axis]) / Dir[Axis];
+		if (T0 > T1)
+		{
+			Swap(T0, T1);
+		}
+		EnterTime = FMath::Max(EnterTime, T0);
+		ExitTime = FMath::Min(ExitTime, T1);
+		if (EnterTime > ExitTime)
+		{
+			return false;
+		}
+	}
+
+	OutEnterTime = EnterTime;
+	return true;
+}
+
+/** Two-sided segment vs triangle test, lowers InOutTime on a hit before it */
+static bool IntersectSegmentTriangle(const FVector& Start, const FVector& Dir, const FVector& A, const FVector& B, const FVector& C, double& InOutTime)
+{
+	const FVector Edge1 = B - A;
+	const FVector Edge2 = C - A;
+	const FVector P = Dir ^ Edge2;
+	const double Det = Edge1 | P;
+	if (FMath::Abs(Det) < UE_DOUBLE_SMALL_NUMBER)
+	{
+		return false;
+	}
+
+	const double InvDet = 1.0 / Det;
+	const FVector T = Start - A;
+	const double U = (T | P) * InvDet;
+	if (U < 0.0 || U > 1.0)
+	{
+		return false;
+	}
+
+	const FVector Q = T ^ Edge1;
+	const double V = (Dir | Q) * InvDet;
+	if (V < 0.0 || U + V > 1.0)
+	{
+		return false;
+	}
+
+	const double Time = (Edge2 | Q) * InvDet;
+	if (Time < 0.0 || Time > InOutTime)
+	{
+		return false;
+	}
+
+	InOutTime = Time;
+	return true;
+}
+
+/** Sphere swept along Start + Time * Dir vs a sphere around Center, lowers InOutTime on a hit before it */
+static bool SweepSpherePoint(const FVector& Start, const FVector& Dir, double Radius, const FVector& Center, double& InOutTime, FVector& OutNormal)
+{
+	const FVector M = Start - Center;
+	const double C = M.SizeSquared() - Radius * Radius;
+	double Time = 0.0;
+	if (C > 0.0)
+	{
+		const double A = Dir.SizeSquared();
+		const double B = 2.0 * (Dir | M);
+		const double Discriminant = B * B - 4.0 * A * C;
+		if (A < UE_DOUBLE_SMALL_NUMBER || B >= 0.0 || Discriminant < 0.0)
+		{
+			return false;
+		}
+		Time = (-B - FMath::Sqrt(Discriminant)) / (2.0 * A);
+	}
+
+	if (Time > InOutTime)
+	{
+		return false;
+	}
+
+	InOutTime = Time;
+	OutNormal = (Start + Dir * Time - Center).GetSafeNormal();
+	return true;
+}
+
+/** Sphere swept along Start + Time * Dir vs the side of the capsule around an edge, lowers InOutTime on a hit before it */
+static bool SweepSphereEdge(const FVector& Start, const FVector& Dir, double Radius, const FVector& P, const FVector& Q, double& InOutTime, FVector& OutNormal)
+{
+	const FVector Edge = Q - P;
+	const double EdgeLengthSquared = Edge.SizeSquared();
+	if (EdgeLengthSquared < UE_DOUBLE_SMALL_NUMBER)
+	{
+		return false;
+	}
+
+	// Distance to the infinite line through the edge; the capsule caps are the vertex spheres
+	const FVector M = Start - P;
+	const FVector DirPerp = Dir - Edge * ((Dir | Edge) / EdgeLengthSquared);
+	const FVector MPerp = M - Edge * ((M | Edge) / EdgeLengthSquared);
+	const double C = MPerp.SizeSquared() - Radius * Radius;
+	double Time = 0.0;
+	if (C > 0.0)
+	{
+		const double A = DirPerp.SizeSquared();
+		const double B = 2.0 * (DirPerp | MPerp);
+		const double Discriminant = B * B - 4.0 * A * C;
+		if (A < UE_DOUBLE_SMALL_NUMBER || B >= 0.0 || Discriminant < 0.0)
+		{
+			return false;
+		}
+		Time = (-B - FMath::Sqrt(Discriminant)) / (2.0 * A);
+	}
+
+	if (Time > InOutTime)
+	{
+		return false;
+	}
+
+	const FVector Center = Start + Dir * Time;
+	const double EdgeParam = ((Center - P) | Edge) / EdgeLengthSquared;
+	if (EdgeParam < 0.0 || EdgeParam > 1.0)
+	{
+		return false;
+	}
+
+	InOutTime = Time;
+	OutNormal = (Center - (P + Edge * EdgeParam)).GetSafeNormal();
+	return true;
+}
+
+/** True if a point in the plane of a triangle lies inside it */
+static bool IsPointInTriangle(const FVector& Point, const FVector& A, const FVector& B, const FVector& C, const FVector& Normal)
+{
+	return (((B - A) ^ (Point - A)) | Normal) >= 0.0 &&
+		(((C - B) ^ (Point - B)) | Normal) >= 0.0 &&
+		(((A - C) ^ (Point - C)) | Normal) >= 0.0;
+}
+
+/** Sphere swept along Start + Time * Dir vs a triangle from either side, lowers InOutTime on a hit before it */
+static bool SweepSphereTriangle(const FVector& Start, const FVector& Dir, double Radius, const FVector& A, const FVector& B, const FVector& C, double& InOutTime, FVector& OutNormal)
+{
+	FVector Normal = ((B - A) ^ (C - A)).GetSafeNormal();
+	if (Normal.IsZero())
+	{
+		return false;
+	}
+
+	// Face: the first touch of the plane, if it happens inside the triangle nothing else touches earlier
+	double StartDistance = (Start - A) | Normal;
+	const FVector FaceNormal = StartDistance < 0.0 ? -Normal : Normal;
+	StartDistance = FMath::Abs(StartDistance);
+	const double Approach = Dir | FaceNormal;
+
+	double FaceTime = -1.0;
+	if (StartDistance <= Radius)
+	{
+		FaceTime = 0.0;
+	}
+	else if (Approach < 0.0)
+	{
+		FaceTime = (StartDistance - Radius) / -Approach;
+	}
+
+	if (FaceTime >= 0.0 && FaceTime <= InOutTime)
+	{
+		const FVector Center = Start + Dir * FaceTime;
+		const FVector Projected = Center - FaceNormal * ((Center - A) | FaceNormal);
+		if (IsPointInTriangle(Projected, A, B, C, Normal))
+		{
+			InOutTime = FaceTime;
+			OutNormal = FaceNormal;
+			return true;
+		}
+	}
+
+	// Edges and corners
+	bool bHit = false;
+	bHit |= SweepSphereEdge(Start, Dir, Radius, A, B, InOutTime, OutNormal);
+	bHit |= SweepSphereEdge(Start, Dir, Radius, B, C, InOutTime, OutNormal);
+	bHit |= SweepSphereEdge(Start, Dir, Radius, C, A, InOutTime, OutNormal);
+	bHit |= SweepSpherePoint(Start, Dir, Radius, A, InOutTime, OutNormal);
+	bHit |= SweepSpherePoint(Start, Dir, Radius, B, InOutTime, OutNormal);
+	bHit |= SweepSpherePoint(Start, Dir, Radius, C, InOutTime, OutNormal);
+
+	// Starting right on an edge or corner leaves no direction to push out along
+	if (bHit && OutNormal.IsZero())
+	{
+		OutNormal = FaceNormal;
+	}
+	return bHit;
+}
+
+FHeightfieldQuery::FHeightfieldQuery(FHeightfieldDataPtr InData, const FTransform& InLocalToWorld, const FVector& InHeightfieldScale)
+	: Data(MoveTemp(InData))
+	, ToWorld(InLocalToWorld.GetRotation(), InLocalToWorld.GetTranslation())
+{
+	const FVector WorldScale = InLocalToWorld.GetScale3D();
+	Spacing = FVector(
+		InHeightfieldScale.X * WorldScale.X,
+		InHeightfieldScale.Y * WorldScale.Y,
+		InHeightfieldScale.Z * WorldScale.Z * QUERY_HEIGHTFIELD_ZSCALE);
+}
+
+int32 FHeightfieldQuery::GetMaterialIndexLocal(double LocalX, double LocalY) const
+{
+	const int32 Width = Data->GetWidth();
+	const int32 Height = Data->GetHeight();
+	const double GridX = LocalX / Spacing.X;
+	const double GridY = LocalY / Spacing.Y;
+	if (!(GridX >= 0.0 && GridY >= 0.0 && GridX <= Width - 1 && GridY <= Height - 1))
+	{
+		return INDEX_NONE;
+	}
+
+	const int32 CellX = FMath::Min(FMath::FloorToInt32(GridX), Width - 2);
+	const int32 CellY = FMath::Min(FMath::FloorToInt32(GridY), Height - 2);
+	return Data->GetMaterialIndices()[CellY * Width + CellX];
+}
+
+bool FHeightfieldQuery::SampleLocal(double LocalX, double LocalY, double& OutZ, FVector& OutNormal) const
+{
+	const int32 Width = Data->GetWidth();
+	const int32 Height = Data->GetHeight();
+	const double GridX = LocalX / Spacing.X;
+	const double GridY = LocalY / Spacing.Y;
+	if (!(GridX >= 0.0 && GridY >= 0.0 && GridX <= Width - 1 && GridY <= Height - 1))
+	{
+		return false;
+	}
+
+	const int32 CellX = FMath::Min(FMath::FloorToInt32(GridX), Width - 2);
+	const int32 CellY = FMath::Min(FMath::FloorToInt32(GridY), Height - 2);
+	const double FracX = GridX - CellX;
+	const double FracY = GridY - CellY;
+
+	const FVector V00 = GetLocalVertex(CellX, CellY);
+	const FVector V10 = GetLocalVertex(CellX + 1, CellY);
+	const FVector V01 = GetLocalVertex(CellX, CellY + 1);
+	const FVector V11 = GetLocalVertex(CellX + 1, CellY + 1);
+
+	// Same split as Chaos::FHeightField
+	if (FracX > FracY)
+	{
+		OutZ = V00.Z + (V10.Z - V00.Z) * FracX + (V11.Z - V10.Z) * FracY;
+		OutNormal = (V10 - V00) ^ (V11 - V00);
+	}
+	else
+	{
+		OutZ = V00.Z + (V11.Z - V01.Z) * FracX + (V01.Z - V00.Z) * FracY;
+		OutNormal = (V11 - V00) ^ (V01 - V00);
+	}
+	return true;
+}
+
+FBox FHeightfieldQuery::GetNodeBounds(int32 Level, int32 NodeX, int32 NodeY) const
+{
+	const FIntRect Samples = Data->GetMinMaxNodeSamples(Level, NodeX, NodeY);
+	const FHeightfieldHeightRange& Range = Data->GetMinMaxNode(Level, NodeX, NodeY);
+	const FVector Corner0(Samples.Min.X * Spacing.X, Samples.Min.Y * Spacing.Y, (static_cast<double>(Range.Min) - 32768.0) * Spacing.Z);
+	const FVector Corner1(Samples.Max.X * Spacing.X, Samples.Max.Y * Spacing.Y, (static_cast<double>(Range.Max) - 32768.0) * Spacing.Z);
+	return FBox(Corner0.ComponentMin(Corner1), Corner0.ComponentMax(Corner1));
+}
+
+FBox FHeightfieldQuery::GetCellBounds(int32 CellX, int32 CellY) const
+{
+	FBox Bounds(ForceInit);
+	Bounds += GetLocalVertex(CellX, CellY);
+	Bounds += GetLocalVertex(CellX + 1, CellY);
+	Bounds += GetLocalVertex(CellX, CellY + 1);
+	Bounds += GetLocalVertex(CellX + 1, CellY + 1);
+	return Bounds;
+}
+
+template<typename CellTestType>
+void FHeightfieldQuery::TraceCells(const FVector& Start, const FVector& Dir, double Inflate, double& InOutTime, CellTestType&& CellTest) const
+{
+	struct FNodeRef
+	{
+		int32 Level;
+		int32 X;
+		int32 Y;
+		double EnterTime;
+	};
+
+	const int32 NumLevels = Data->GetNumMinMaxLevels();
+	if (NumLevels == 0)
+	{
+		return;
+	}
+
+	TArray<FNodeRef, TInlineAllocator<64>> Stack;
+	double RootTime;
+	if (IntersectSegmentBox(Start, Dir, GetNodeBounds(NumLevels - 1, 0, 0).ExpandBy(Inflate), InOutTime, RootTime))
+	{
+		Stack.Add({ NumLevels - 1, 0, 0, RootTime });
+	}
+
+	while (Stack.Num() > 0)
+	{
+		const FNodeRef Node = Stack.Pop(EAllowShrinking::No);
+		if (Node.EnterTime > InOutTime)
+		{
+			continue;
+		}
+
+		if (Node.Level == 0)
+		{
+			// Leaf: test the cells it covers, cheapest reject first
+			const FIntRect Samples = Data->GetMinMaxNodeSamples(0, Node.X, Node.Y);
+			for (int32 CellY = Samples.Min.Y; CellY < Samples.Max.Y; ++CellY)
+			{
+				for (int32 CellX = Samples.Min.X; CellX < Samples.Max.X; ++CellX)
+				{
+					double CellTime;
+					if (IntersectSegmentBox(Start, Dir, GetCellBounds(CellX, CellY).ExpandBy(Inflate), InOutTime, CellTime))
+					{
+						CellTest(CellX, CellY, InOutTime);
+					}
+				}
+			}
+			continue;
+		}
+
+		// Push the children farthest first, so the nearest one is tested next
+		FNodeRef Children[4];
+		int32 NumChildren = 0;
+		const FIntPoint ChildLevelSize = Data->GetMinMaxLevelSize(Node.Level - 1);
+		for (int32 ChildY = Node.Y * 2; ChildY < FMath::Min(Node.Y * 2 + 2, ChildLevelSize.Y); ++ChildY)
+		{
+			for (int32 ChildX = Node.X * 2; ChildX < FMath::Min(Node.X * 2 + 2, ChildLevelSize.X); ++ChildX)
+			{
+				double ChildTime;
+				if (IntersectSegmentBox(Start, Dir, GetNodeBounds(Node.Level - 1, ChildX, ChildY).ExpandBy(Inflate), InOutTime, ChildTime))
+				{
+					Children[NumChildren++] = { Node.Level - 1, ChildX, ChildY, ChildTime };
+				}
+			}
+		}
+
+		Algo::Sort(MakeArrayView(Children, NumChildren), [](const FNodeRef& A, const FNodeRef& B) { return A.EnterTime > B.EnterTime; });
+		Stack.Append(Children, NumChildren);
+	}
+}
+
+bool FHeightfieldQuery::GetHeightAtWorldXY(const FVector2D& WorldXY, float& OutHeight) const
+{
+	if (!IsValid())
+	{
+		return false;
+	}
+
+	FReadScopeLock ReadLock(Data->GetLock());
+
+	const FVector Local = ToWorld.InverseTransformPosition(FVector(WorldXY, ToWorld.GetTranslation().Z));
+	double LocalZ;
+	FVector Normal;
+	if (!SampleLocal(Local.X, Local.Y, LocalZ, Normal))
+	{
+		return false;
+	}
+
+	OutHeight = ToWorld.TransformPosition(FVector(Local.X, Local.Y, LocalZ)).Z;
+	return true;
+}
+
+bool FHeightfieldQuery::GetNormalAtWorldXY(const FVector2D& WorldXY, FVector& OutNormal) const
+{
+	if (!IsValid())
+	{
+		return false;
+	}
+
+	FReadScopeLock ReadLock(Data->GetLock());
+
+	const FVector Local = ToWorld.InverseTransformPosition(FVector(WorldXY, ToWorld.GetTranslation().Z));
+	double LocalZ;
+	FVector Normal;
+	if (!SampleLocal(Local.X, Local.Y, LocalZ, Normal))
+	{
+		return false;
+	}
+
+	OutNormal = ToWorld.TransformVectorNoScale(Normal.GetSafeNormal());
+	return true;
+}
+
+bool FHeightfieldQuery::GetMaterialIndexAtWorldXY(const FVector2D& WorldXY, uint8& OutMaterialIndex) const
+{
+	if (!IsValid())
+	{
+		return false;
+	}
+
+	FReadScopeLock ReadLock(Data->GetLock());
+
+	const FVector Local = ToWorld.InverseTransformPosition(FVector(WorldXY, ToWorld.GetTranslation().Z));
+	const int32 MaterialIndex = GetMaterialIndexLocal(Local.X, Local.Y);
+	if (MaterialIndex == INDEX_NONE)
+	{
+		return false;
+	}
+
+	OutMaterialIndex = static_cast<uint8>(MaterialIndex);
+	return true;
+}
+
+bool FHeightfieldQuery::RaycastHeightfield(const FVector& Start, const FVector& End, FHeightfieldQueryHit& OutHit) const
+{
+	OutHit = FHeightfieldQueryHit();
+	if (!IsValid())
+	{
+		return false;
+	}
+
+	FReadScopeLock ReadLock(Data->GetLock());
+	return RaycastNoLock(Start, End, OutHit);
+}
+
+bool FHeightfieldQuery::RaycastNoLock(const FVector& Start, const FVector& End, FHeightfieldQueryHit& OutHit) const
+{
+	const FVector LocalStart = ToWorld.InverseTransformPosition(Start);
+	const FVector LocalDir = ToWorld.InverseTransformVector(End - Start);
+
+	double BestTime = 1.0;
+	FVector BestNormal = FVector::UpVector;
+	TraceCells(LocalStart, LocalDir, 0.0, BestTime, [this, &LocalStart, &LocalDir, &BestNormal, &OutHit](int32 CellX, int32 CellY, double& InOutTime)
+	{
+		const FVector V00 = GetLocalVertex(CellX, CellY);
+		const FVector V10 = GetLocalVertex(CellX + 1, CellY);
+		const FVector V01 = GetLocalVertex(CellX, CellY + 1);
+		const FVector V11 = GetLocalVertex(CellX + 1, CellY + 1);
+
+		if (IntersectSegmentTriangle(LocalStart, LocalDir, V00, V10, V11, InOutTime))
+		{
+			BestNormal = (V10 - V00) ^ (V11 - V00);
+			OutHit.Cell = FIntPoint(CellX, CellY);
+		}
+		if (IntersectSegmentTriangle(LocalStart, LocalDir, V00, V11, V01, InOutTime))
+		{
+			BestNormal = (V11 - V00) ^ (V01 - V00);
+			OutHit.Cell = FIntPoint(CellX, CellY);
+		}
+	});
+
+	if (OutHit.Cell.X == INDEX_NONE)
+	{
+		return false;
+	}
+
+	OutHit.bBlockingHit = true;
+	OutHit.Time = static_cast<float>(BestTime);
+	OutHit.Location = Start + (End - Start) * BestTime;
+	OutHit.ImpactPoint = OutHit.Location;
+	OutHit.Normal = ToWorld.TransformVectorNoScale(BestNormal.GetSafeNormal());
+	return true;
+}
+
+bool FHeightfieldQuery::SphereSweepHeightfield(const FVector& Start, const FVector& End, float Radius, FHeightfieldQueryHit& OutHit) const
+{
+	OutHit = FHeightfieldQueryHit();
+	if (!IsValid())
+	{
+		return false;
+	}
+
+	FReadScopeLock ReadLock(Data->GetLock());
+
+	const FVector LocalStart = ToWorld.InverseTransformPosition(Start);
+	const FVector LocalDir = ToWorld.InverseTransformVector(End - Start);
+
+	double BestTime = 1.0;
+	FVector BestNormal = FVector::UpVector;
+	TraceCells(LocalStart, LocalDir, Radius, BestTime, [this, &LocalStart, &LocalDir, Radius, &BestNormal, &OutHit](int32 CellX, int32 CellY, double& InOutTime)
+	{
+		const FVector V00 = GetLocalVertex(CellX, CellY);
+		const FVector V10 = GetLocalVertex(CellX + 1, CellY);
+		const FVector V01 = GetLocalVertex(CellX, CellY + 1);
+		const FVector V11 = GetLocalVertex(CellX + 1, CellY + 1);
+
+		if (SweepSphereTriangle(LocalStart, LocalDir, Radius, V00, V10, V11, InOutTime, BestNormal))
+		{
+			OutHit.Cell = FIntPoint(CellX, CellY);
+		}
+		if (SweepSphereTriangle(LocalStart, LocalDir, Radius, V00, V11, V01, InOutTime, BestNormal))
+		{
+			OutHit.Cell = FIntPoint(CellX, CellY);
+		}
+	});
+
+	if (OutHit.Cell.X == INDEX_NONE)
+	{
+		return false;
+	}
+
+	OutHit.bBlockingHit = true;
+	OutHit.Time = static_cast<float>(BestTime);
+	OutHit.Location = Start + (End - Start) * BestTime;
+	OutHit.Normal = ToWorld.TransformVectorNoScale(BestNormal);
+	OutHit.ImpactPoint = OutHit.Location - OutHit.Normal * Radius;
+	return true;
+}
+
+void FHeightfieldQuery::GetHeightsAtWorldXY(TConstArrayView<FVector2D> WorldXY, TArrayView<float> OutHeights, float DefaultHeight) const
+{
+	check(WorldXY.Num() == OutHeights.Num());
+	if (!IsValid())
+	{
+		for (float& Height : OutHeights)
+		{
+			Height = DefaultHeight;
+		}
+		return;
+	}
+
+	FReadScopeLock ReadLock(Data->GetLock());
+
+	for (int32 i = 0; i < WorldXY.Num(); ++i)
+	{
+		const FVector Local = ToWorld.InverseTransformPosition(FVector(WorldXY[i], ToWorld.GetTranslation().Z));
+		double LocalZ;
+		FVector Normal;
+		OutHeights[i] = SampleLocal(Local.X, Local.Y, LocalZ, Normal) ?
+			ToWorld.TransformPosition(FVector(Local.X, Local.Y, LocalZ)).Z : DefaultHeight;
+	}
+}
+
+void FHeightfieldQuery::GetMaterialIndicesAtWorldXY(TConstArrayView<FVector2D> WorldXY, TArrayView<int32> OutMaterialIndices) const
+{
+	check(WorldXY.Num() == OutMaterialIndices.Num());
+	if (!IsValid())
+	{
+		for (int32& MaterialIndex : OutMaterialIndices)
+		{
+			MaterialIndex = INDEX_NONE;
+		}
+		return;
+	}
+
+	FReadScopeLock ReadLock(Data->GetLock());
+
+	for (int32 i = 0; i < WorldXY.Num(); ++i)
+	{
+		const FVector Local = ToWorld.InverseTransformPosition(FVector(WorldXY[i], ToWorld.GetTranslation().Z));
+		OutMaterialIndices[i] = GetMaterialIndexLocal(Local.X, Local.Y);
+	}
+}
+
+void FHeightfieldQuery::RaycastHeightfieldBatch(TConstArrayView<FVector> Starts, TConstArrayView<FVector> Ends, TArrayView<FHeightfieldQueryHit> OutHits) const
+{
+	check(Starts.Num() == Ends.Num() && Starts.Num() == OutHits.Num());
+	for (FHeightfieldQueryHit& Hit : OutHits)
+	{
+		Hit = FHeightfieldQueryHit();
+	}
+
+	if (!IsValid())
+	{
+		return;
+	}
+
+	FReadScopeLock ReadLock(Data->GetLock());
+
+	for (int32 i = 0; i < Starts.Num(); ++i)
+	{
+		RaycastNoLock(Starts[i], Ends[i], OutHits[i]);
+	}
+}
+
+/** Fires random rays at every heightfield collision component in the world with both the CPU queries and scene traces */
+static void BenchmarkHeightfieldQueries(const TArray<FString>& Args, UWorld* World)
+{
+	const int32 NumRays = Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 10000;
+	static constexpr int32 RaysPerBatch = 1024;
+
+	for (TObjectIterator<UHeightfieldMeshCollisionComponent> It; It; ++It)
+	{
+		UHeightfieldMeshCollisionComponent* Component = *It;
+		const FHeightfieldQuery Query = Component->GetHeightfieldQuery();
+		if (Component->GetWorld() != World || !Query.IsValid())
+		{
+			continue;
+		}
+
+		// Steep rays from above the terrain to below it, a few cells sideways
+		const FBox Bounds = Component->Bounds.GetBox();
+		const double SideOffset = Bounds.GetSize().X * 0.01;
+		FRandomStream Random(NumRays);
+		TArray<FVector> Starts, Ends;
+		Starts.SetNumUninitialized(NumRays);
+		Ends.SetNumUninitialized(NumRays);
+		for (int32 i = 0; i < NumRays; ++i)
+		{
+			const FVector2D XY(Random.FRandRange(Bounds.Min.X, Bounds.Max.X), Random.FRandRange(Bounds.Min.Y, Bounds.Max.Y));
+			Starts[i] = FVector(XY, Bounds.Max.Z + 100.0);
+			Ends[i] = FVector(XY + FVector2D(Random.FRandRange(-SideOffset, SideOffset), Random.FRandRange(-SideOffset, SideOffset)), Bounds.Min.Z - 100.0);
+		}
+
+		TArray<FHeightfieldQueryHit> CpuHits;
+		CpuHits.SetNum(NumRays);
+
+		double StartTime = FPlatformTime::Seconds();
+		Query.RaycastHeightfieldBatch(Starts, Ends, CpuHits);
+		const double SerialTime = FPlatformTime::Seconds() - StartTime;
+
+		StartTime = FPlatformTime::Seconds();
+		ParallelFor(FMath::DivideAndRoundUp(NumRays, RaysPerBatch), [&Query, &Starts, &Ends, &CpuHits](int32 BatchIndex)
+		{
+			const int32 First = BatchIndex * RaysPerBatch;
+			const int32 Num = FMath::Min(RaysPerBatch, Starts.Num() - First);
+			Query.RaycastHeightfieldBatch(
+				MakeArrayView(Starts).Mid(First, Num), MakeArrayView(Ends).Mid(First, Num), MakeArrayView(CpuHits).Mid(First, Num));
+		});
+		const double ParallelTime = FPlatformTime::Seconds() - StartTime;
+
+		// Trace against the component only, so other geometry doesn't count as a mismatch
+		FCollisionQueryParams Params(SCENE_QUERY_STAT(HeightfieldQueryBenchmark), false);
+		int32 NumMismatches = 0;
+		double MaxDistance = 0.0;
+		StartTime = FPlatformTime::Seconds();
+		for (int32 i = 0; i < NumRays; ++i)
+		{
+			FHitResult SceneHit;
+			const bool bSceneHit = Component->LineTraceComponent(SceneHit, Starts[i], Ends[i], Params);
+			if (bSceneHit != CpuHits[i].bBlockingHit)
+			{
+				++NumMismatches;
+			}
+			else if (bSceneHit)
+			{
+				MaxDistance = FMath::Max(MaxDistance, FVector::Dist(SceneHit.Location, CpuHits[i].Location));
+			}
+		}
+		const double SceneTime = FPlatformTime::Seconds() - StartTime;
+
+		UE_LOG(LogTemp, Log, TEXT("HeightfieldQuery: %s, %d rays: CPU %.2f ms (%.2f ms parallel), scene traces %.2f ms. Hit mismatches %d, max hit distance %.3f"),
+			*Component->GetPathName(), NumRays, SerialTime * 1000.0, ParallelTime * 1000.0, SceneTime * 1000.0, NumMismatches, MaxDistance);
+	}
+}
+
+static FAutoConsoleCommandWithWorldAndArgs GHeightfieldQueryBenchmarkCommand(
+	TEXT("HeightfieldMesh.BenchmarkQueries"),
+	TEXT("Compares CPU heightfield raycasts with collision traces on every heightfield collision component. Optional argument: number of rays (default 10000)."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&BenchmarkHeightfieldQueries));
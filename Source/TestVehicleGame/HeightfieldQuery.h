@@ -0,0 +1,117 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HeightfieldData.h"
+
+/** Result of a heightfield ray or sphere sweep query */
+struct FHeightfieldQueryHit
+{
+	bool bBlockingHit = false;
+
+	/** Fraction of the way from Start to End */
+	float Time = 1.0f;
+
+	/** Ray: the hit point. Sweep: the sphere center at the time of the hit. World space */
+	FVector Location = FVector::ZeroVector;
+
+	/** Point of contact on the surface, world space */
+	FVector ImpactPoint = FVector::ZeroVector;
+
+	/** Surface normal for ray hits, direction away from the contact for sweeps. World space */
+	FVector Normal = FVector::UpVector;
+
+	/** Column and row of the cell that was hit */
+	FIntPoint Cell = FIntPoint(INDEX_NONE, INDEX_NONE);
+};
+
+/**
+ * Queries against heightfield data placed in the world, answered on the CPU straight from the
+ * heights without going through the physics scene. Cells are split into the same two triangles
+ * as Chaos::FHeightField, along the (X, Y) -> (X + 1, Y + 1) diagonal, so the results match
+ * traces against the heightfield collision.
+ *
+ * A query is a small snapshot (data reference and placement) and can be used from any thread.
+ * Every call holds the data's read lock, batched calls hold it once for the whole batch.
+ * Rays and sweeps descend the min/max pyramid of the data and only test the cells they pass.
+ *
+ * XY queries look along world Z, so they expect the heightfield to be rotated around Z only.
+ */
+class TESTVEHICLEGAME_API FHeightfieldQuery
+{
+public:
+	FHeightfieldQuery() = default;
+
+	/**
+	 * @param InLocalToWorld - Transform of the heightfield; its scale is folded into the sample spacing
+	 * @param InHeightfieldScale - Sample spacing (X, Y) and height scale (Z), as set on the components
+	 */
+	FHeightfieldQuery(FHeightfieldDataPtr InData, const FTransform& InLocalToWorld, const FVector& InHeightfieldScale);
+
+	bool IsValid() const { return Data.IsValid() && Data->GetWidth() > 1 && Data->GetHeight() > 1; }
+
+	/** World Z of the surface at a world XY location, false outside the heightfield */
+	bool GetHeightAtWorldXY(const FVector2D& WorldXY, float& OutHeight) const;
+
+	/** World normal of the surface triangle at a world XY location, false outside the heightfield */
+	bool GetNormalAtWorldXY(const FVector2D& WorldXY, FVector& OutNormal) const;
+
+	/**
+	 * Material index (R channel) of the cell at a world XY location, false outside the heightfield.
+	 * A cell uses the index of its first sample, as the heightfield collision does.
+	 */
+	bool GetMaterialIndexAtWorldXY(const FVector2D& WorldXY, uint8& OutMaterialIndex) const;
+
+	/** First hit of the segment Start -> End with the surface, from either side */
+	bool RaycastHeightfield(const FVector& Start, const FVector& End, FHeightfieldQueryHit& OutHit) const;
+
+	/** First hit of a sphere swept from Start to End. A sphere that starts penetrating hits at Time 0 */
+	bool SphereSweepHeightfield(const FVector& Start, const FVector& End, float Radius, FHeightfieldQueryHit& OutHit) const;
+
+	/** GetHeightAtWorldXY for many locations. Locations outside the heightfield get DefaultHeight */
+	void GetHeightsAtWorldXY(TConstArrayView<FVector2D> WorldXY, TArrayView<float> OutHeights, float DefaultHeight = 0.0f) const;
+
+	/** GetMaterialIndexAtWorldXY for many locations. Locations outside the heightfield get INDEX_NONE */
+	void GetMaterialIndicesAtWorldXY(TConstArrayView<FVector2D> WorldXY, TArrayView<int32> OutMaterialIndices) const;
+
+	/** RaycastHeightfield for many segments */
+	void RaycastHeightfieldBatch(TConstArrayView<FVector> Starts, TConstArrayView<FVector> Ends, TArrayView<FHeightfieldQueryHit> OutHits) const;
+
+private:
+	/** Heightfield-space position of a sample: X, Y along the grid, Z the height */
+	FVector GetLocalVertex(int32 X, int32 Y) const
+	{
+		return FVector(X * Spacing.X, Y * Spacing.Y, (static_cast<double>(Data->GetHeightAt(X, Y)) - 32768.0) * Spacing.Z);
+	}
+
+	/** Material index of the cell at a heightfield-space XY, INDEX_NONE outside the heightfield. Doesn't lock */
+	int32 GetMaterialIndexLocal(double LocalX, double LocalY) const;
+
+	/** Height and (unnormalized) triangle normal at a heightfield-space XY, without locking */
+	bool SampleLocal(double LocalX, double LocalY, double& OutZ, FVector& OutNormal) const;
+
+	/** Heightfield-space box around the samples and heights of a pyramid node */
+	FBox GetNodeBounds(int32 Level, int32 NodeX, int32 NodeY) const;
+
+	/** Heightfield-space box around the four samples of a cell */
+	FBox GetCellBounds(int32 CellX, int32 CellY) const;
+
+	/**
+	 * Calls CellTest(CellX, CellY, InOutTime) for the cells whose bounds, grown by Inflate,
+	 * the segment Start + Time * Dir passes before InOutTime, nearest first. Doesn't lock.
+	 */
+	template<typename CellTestType>
+	void TraceCells(const FVector& Start, const FVector& Dir, double Inflate, double& InOutTime, CellTestType&& CellTest) const;
+
+	/** RaycastHeightfield without locking */
+	bool RaycastNoLock(const FVector& Start, const FVector& End, FHeightfieldQueryHit& OutHit) const;
+
+	FHeightfieldDataPtr Data;
+
+	/** Placement of the heightfield without scale, the scale lives in Spacing */
+	FTransform ToWorld = FTransform::Identity;
+
+	/** World units between samples (X, Y) and per raw height unit (Z) */
+	FVector Spacing = FVector::OneVector;
+};
@@ -0,0 +1,394 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "HeightfieldStreamingTerrain.h"
+#include "HeightfieldMeshComponent.h"
+#include "HeightfieldMeshCollisionComponent.h"
+#include "Components/SceneComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "Misc/Paths.h"
+
+// Rough resident cost of a tile per sample: heights and material indices of the data (3 bytes),
+// the Chaos copy of both with its per-cell bounds (about 8 bytes)
+static constexpr int64 STREAMING_DATA_BYTES_PER_SAMPLE = 3 + 8;
+
+// GPU vertex at full resolution (position, tangents, UV) plus its share of the indices of all chunk LODs
+static constexpr int64 STREAMING_MESH_BYTES_PER_SAMPLE = 28 + 16;
+
+AHeightfieldStreamingTerrain::AHeightfieldStreamingTerrain(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	PrimaryActorTick.bCanEverTick = true;
+
+	USceneComponent* Root = CreateDefaultSubobject<USceneComponent>(TEXT("Root"));
+	Root->SetMobility(EComponentMobility::Static);
+	RootComponent = Root;
+
+	// Templates for the components of the tiles, they never render or collide themselves
+	MeshSettings = CreateDefaultSubobject<UHeightfieldMeshComponent>(TEXT("MeshSettings"));
+	MeshSettings->bAutoRegister = false;
+	MeshSettings->SetBuildAsync(true);
+
+	CollisionSettings = CreateDefaultSubobject<UHeightfieldMeshCollisionComponent>(TEXT("CollisionSettings"));
+	CollisionSettings->bAutoRegister = false;
+}
+
+void AHeightfieldStreamingTerrain::BeginPlay()
+{
+	Super::BeginPlay();
+
+	const FString Filename = FPaths::IsRelative(TiledHeightmapFile.FilePath) ?
+		FPaths::Combine(FPaths::ProjectDir(), TiledHeightmapFile.FilePath) : TiledHeightmapFile.FilePath;
+	File = FHeightfieldTiledFile::Open(Filename);
+	if (!File.IsValid())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("HeightfieldStreaming: %s has no terrain to stream, can't open %s"), *GetName(), *Filename);
+		return;
+	}
+
+	if (!MeshSettings->GetHeightfieldScale().Equals(CollisionSettings->GetHeightfieldScale()))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("HeightfieldStreaming: Mesh and collision of %s use different heightfield scales, tiles are placed by the collision scale"), *GetName());
+	}
+
+	NumTiles = FIntPoint(
+		FMath::Max(1, FMath::DivideAndRoundUp(File->GetWidth() - 1, TileSize)),
+		FMath::Max(1, FMath::DivideAndRoundUp(File->GetHeight() - 1, TileSize)));
+
+	UE_LOG(LogTemp, Log, TEXT("HeightfieldStreaming: Streaming %s (%d x %d) in %d x %d tiles"),
+		*Filename, File->GetWidth(), File->GetHeight(), NumTiles.X, NumTiles.Y);
+
+	UpdateStreaming();
+}
+
+void AHeightfieldStreamingTerrain::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	ReleaseAllTiles();
+	File.Reset();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void AHeightfieldStreamingTerrain::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	if (!File.IsValid())
+	{
+		return;
+	}
+
+	CompleteFinishedLoads();
+
+	TimeSinceUpdate += DeltaSeconds;
+	if (TimeSinceUpdate >= UpdateInterval)
+	{
+		TimeSinceUpdate = 0.0f;
+		UpdateStreaming();
+	}
+}
+
+void AHeightfieldStreamingTerrain::AddStreamingSource(AActor* Source)
+{
+	if (Source)
+	{
+		ExtraSources.AddUnique(Source);
+	}
+}
+
+void AHeightfieldStreamingTerrain::RemoveStreamingSource(AActor* Source)
+{
+	ExtraSources.Remove(Source);
+}
+
+void AHeightfieldStreamingTerrain::FlushStreaming()
+{
+	if (!File.IsValid())
+	{
+		return;
+	}
+
+	// Reads are started a few at a time, keep going until every wanted tile has been read
+	for (;;)
+	{
+		UpdateStreaming();
+
+		bool bAnyLoading = false;
+		for (TPair<FIntPoint, FHeightfieldStreamingTile>& Pair : Tiles)
+		{
+			if (Pair.Value.Load.IsValid())
+			{
+				Pair.Value.Load->Task.Wait();
+				bAnyLoading = true;
+			}
+		}
+
+		if (!bAnyLoading)
+		{
+			break;
+		}
+		CompleteFinishedLoads();
+	}
+
+	// Tile meshes build in the background as well
+	for (TPair<FIntPoint, FHeightfieldStreamingTile>& Pair : Tiles)
+	{
+		if (Pair.Value.Mesh)
+		{
+			Pair.Value.Mesh->WaitForPendingBuild();
+		}
+	}
+}
+
+int64 AHeightfieldStreamingTerrain::GetResidentMemory() const
+{
+	int64 Memory = 0;
+	for (const TPair<FIntPoint, FHeightfieldStreamingTile>& Pair : Tiles)
+	{
+		Memory += Pair.Value.MemoryEstimate;
+	}
+	return Memory;
+}
+
+void AHeightfieldStreamingTerrain::UpdateStreaming()
+{
+	TArray<FVector2D> Sources;
+	GatherSourceLocations(Sources);
+
+	// Distance of every tile within the unload radius of a source to its nearest source
+	const FVector2D Spacing = GetSampleSpacing();
+	const FVector2D TileExtent = Spacing * TileSize;
+	TMap<FIntPoint, double> TileDistances;
+	for (const FVector2D& Source : Sources)
+	{
+		const FIntPoint MinTile(
+			FMath::Max(0, FMath::FloorToInt32((Source.X - UnloadRadius) / TileExtent.X)),
+			FMath::Max(0, FMath::FloorToInt32((Source.Y - UnloadRadius) / TileExtent.Y)));
+		const FIntPoint MaxTile(
+			FMath::Min(NumTiles.X - 1, FMath::FloorToInt32((Source.X + UnloadRadius) / TileExtent.X)),
+			FMath::Min(NumTiles.Y - 1, FMath::FloorToInt32((Source.Y + UnloadRadius) / TileExtent.Y)));
+		for (int32 TileY = MinTile.Y; TileY <= MaxTile.Y; ++TileY)
+		{
+			for (int32 TileX = MinTile.X; TileX <= MaxTile.X; ++TileX)
+			{
+				const FIntPoint TileCoord(TileX, TileY);
+				const double Distance = GetTileDistance(TileCoord, Source);
+				if (Distance <= UnloadRadius)
+				{
+					double& NearestDistance = TileDistances.FindOrAdd(TileCoord, Distance);
+					NearestDistance = FMath::Min(NearestDistance, Distance);
+				}
+			}
+		}
+	}
+
+	TileDistances.ValueSort([](double A, double B) { return A < B; });
+
+	// Nearest tiles first until the budget is used up. Resident tiles stay up to the unload radius,
+	// new ones only come in within the load radius
+	const int64 Budget = static_cast<int64>(MemoryBudgetMB) * 1024 * 1024;
+	int64 UsedMemory = 0;
+	TArray<FIntPoint> WantedTiles;
+	for (const TPair<FIntPoint, double>& Pair : TileDistances)
+	{
+		if (!Tiles.Contains(Pair.Key) && Pair.Value > LoadRadius)
+		{
+			continue;
+		}
+
+		const int64 TileMemory = EstimateTileMemory(Pair.Key);
+		if (UsedMemory + TileMemory > Budget)
+		{
+			break;
+		}
+
+		UsedMemory += TileMemory;
+		WantedTiles.Add(Pair.Key);
+	}
+
+	// Release first, so the budget is never exceeded while tiles come and go
+	const TSet<FIntPoint> WantedSet(WantedTiles);
+	for (auto It = Tiles.CreateIterator(); It; ++It)
+	{
+		if (!WantedSet.Contains(It.Key()))
+		{
+			ReleaseTile(It.Value());
+			It.RemoveCurrent();
+		}
+	}
+
+	AbandonedLoads.RemoveAll([](const UE::Tasks::FTask& Task) { return Task.IsCompleted(); });
+	int32 NumLoads = AbandonedLoads.Num();
+	for (const TPair<FIntPoint, FHeightfieldStreamingTile>& Pair : Tiles)
+	{
+		NumLoads += Pair.Value.Load.IsValid() ? 1 : 0;
+	}
+
+	for (const FIntPoint& TileCoord : WantedTiles)
+	{
+		if (NumLoads >= MaxConcurrentLoads)
+		{
+			break;
+		}
+
+		if (!Tiles.Contains(TileCoord))
+		{
+			StartTileLoad(TileCoord);
+			++NumLoads;
+		}
+	}
+}
+
+void AHeightfieldStreamingTerrain::StartTileLoad(const FIntPoint& TileCoord)
+{
+	FHeightfieldStreamingTile& Tile = Tiles.Add(TileCoord);
+	Tile.MemoryEstimate = EstimateTileMemory(TileCoord);
+	Tile.Load = MakeShared<FHeightfieldStreamingLoad, ESPMode::ThreadSafe>();
+
+	// The task holds the file and the load, not the actor; a load released early just finishes unused
+	const TSharedPtr<FHeightfieldStreamingLoad, ESPMode::ThreadSafe> Load = Tile.Load;
+	const FHeightfieldTiledFilePtr LoadFile = File;
+	const FIntRect Samples = GetTileSamples(TileCoord);
+	Load->Task = UE::Tasks::Launch(UE_SOURCE_LOCATION, [Load, LoadFile, Samples]()
+	{
+		// The apron lets normals along the tile border match the neighbouring tiles
+		Load->Data = LoadFile->ReadRegion(Samples, true);
+	});
+}
+
+void AHeightfieldStreamingTerrain::CompleteFinishedLoads()
+{
+	for (TPair<FIntPoint, FHeightfieldStreamingTile>& Pair : Tiles)
+	{
+		FHeightfieldStreamingTile& Tile = Pair.Value;
+		if (Tile.Load.IsValid() && Tile.Load->Task.IsCompleted())
+		{
+			CompleteTileLoad(Pair.Key, Tile);
+		}
+	}
+}
+
+void AHeightfieldStreamingTerrain::CompleteTileLoad(const FIntPoint& TileCoord, FHeightfieldStreamingTile& Tile)
+{
+	Tile.Data = MoveTemp(Tile.Load->Data);
+	Tile.Load.Reset();
+
+	// A failed tile stays in the map without components, so it isn't read again every update
+	if (!Tile.Data.IsValid())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("HeightfieldStreaming: Failed to read tile (%d, %d) of %s"), TileCoord.X, TileCoord.Y, *GetName());
+		return;
+	}
+
+	const FIntRect Samples = GetTileSamples(TileCoord);
+	const FVector& Scale = CollisionSettings->GetHeightfieldScale();
+	const FVector TileLocation(Samples.Min.X * Scale.X, Samples.Min.Y * Scale.Y, 0.0);
+
+	// Copies of the settings components, placed at the tile's first sample
+	Tile.Collision = NewObject<UHeightfieldMeshCollisionComponent>(this, NAME_None, RF_Transient, CollisionSettings);
+	Tile.Collision->SetupAttachment(RootComponent);
+	Tile.Collision->SetRelativeLocation(TileLocation);
+	Tile.Collision->SetHeightData(Tile.Data);
+	Tile.Collision->RegisterComponent();
+
+	Tile.Mesh = NewObject<UHeightfieldMeshComponent>(this, NAME_None, RF_Transient, MeshSettings);
+	Tile.Mesh->SetupAttachment(RootComponent);
+	Tile.Mesh->SetRelativeLocation(TileLocation);
+	Tile.Mesh->SetHeightData(Tile.Data);
+	Tile.Mesh->RegisterComponent();
+
+	UE_LOG(LogTemp, Verbose, TEXT("HeightfieldStreaming: Loaded tile (%d, %d), %d tiles resident (%.1f MB)"),
+		TileCoord.X, TileCoord.Y, Tiles.Num(), GetResidentMemory() / (1024.0 * 1024.0));
+}
+
+void AHeightfieldStreamingTerrain::ReleaseTile(FHeightfieldStreamingTile& Tile)
+{
+	if (Tile.Load.IsValid())
+	{
+		AbandonedLoads.Add(Tile.Load->Task);
+		Tile.Load.Reset();
+	}
+
+	if (Tile.Mesh)
+	{
+		Tile.Mesh->DestroyComponent();
+		Tile.Mesh = nullptr;
+	}
+
+	if (Tile.Collision)
+	{
+		Tile.Collision->DestroyComponent();
+		Tile.Collision = nullptr;
+	}
+
+	Tile.Data.Reset();
+}
+
+void AHeightfieldStreamingTerrain::ReleaseAllTiles()
+{
+	for (TPair<FIntPoint, FHeightfieldStreamingTile>& Pair : Tiles)
+	{
+		ReleaseTile(Pair.Value);
+	}
+	Tiles.Reset();
+	AbandonedLoads.Reset();
+}
+
+FIntRect AHeightfieldStreamingTerrain::GetTileSamples(const FIntPoint& TileCoord) const
+{
+	return FIntRect(
+		TileCoord.X * TileSize, TileCoord.Y * TileSize,
+		FMath::Min((TileCoord.X + 1) * TileSize + 1, File->GetWidth()),
+		FMath::Min((TileCoord.Y + 1) * TileSize + 1, File->GetHeight()));
+}
+
+int64 AHeightfieldStreamingTerrain::EstimateTileMemory(const FIntPoint& TileCoord) const
+{
+	const int64 NumSamples = GetTileSamples(TileCoord).Area();
+	return NumSamples * (STREAMING_DATA_BYTES_PER_SAMPLE + STREAMING_MESH_BYTES_PER_SAMPLE);
+}
+
+void AHeightfieldStreamingTerrain::GatherSourceLocations(TArray<FVector2D>& OutLocations) const
+{
+	const FTransform& ActorTransform = GetActorTransform();
+	auto AddLocation = [&OutLocations, &ActorTransform](const FVector& WorldLocation)
+	{
+		OutLocations.Add(FVector2D(ActorTransform.InverseTransformPositionNoScale(WorldLocation)));
+	};
+
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		if (const APlayerController* PlayerController = It->Get())
+		{
+			FVector ViewLocation;
+			FRotator ViewRotation;
+			PlayerController->GetPlayerViewPoint(ViewLocation, ViewRotation);
+			AddLocation(ViewLocation);
+		}
+	}
+
+	for (const TWeakObjectPtr<AActor>& Source : ExtraSources)
+	{
+		if (const AActor* SourceActor = Source.Get())
+		{
+			AddLocation(SourceActor->GetActorLocation());
+		}
+	}
+}
+
+FVector2D AHeightfieldStreamingTerrain::GetSampleSpacing() const
+{
+	const FVector& Scale = CollisionSettings->GetHeightfieldScale();
+	const FVector ActorScale = GetActorScale3D();
+	return FVector2D(Scale.X * FMath::Abs(ActorScale.X), Scale.Y * FMath::Abs(ActorScale.Y));
+}
+
+double AHeightfieldStreamingTerrain::GetTileDistance(const FIntPoint& TileCoord, const FVector2D& Location) const
+{
+	const FIntRect Samples = GetTileSamples(TileCoord);
+	const FVector2D Spacing = GetSampleSpacing();
+	const FBox2D TileBox(
+		FVector2D(Samples.Min.X * Spacing.X, Samples.Min.Y * Spacing.Y),
+		FVector2D((Samples.Max.X - 1) * Spacing.X, (Samples.Max.Y - 1) * Spacing.Y));
+	return FMath::Sqrt(TileBox.ComputeSquaredDistanceToPoint(Location));
+}
@@ -0,0 +1,176 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "Engine/EngineTypes.h"
+#include "Tasks/Task.h"
+#include "HeightfieldData.h"
+#include "HeightfieldTiledFile.h"
+#include "HeightfieldStreamingTerrain.generated.h"
+
+class UHeightfieldMeshComponent;
+class UHeightfieldMeshCollisionComponent;
+
+/** Read of a tile's heights running on a background task */
+struct FHeightfieldStreamingLoad
+{
+	UE::Tasks::FTask Task;
+
+	/** Written by the task, null if the read failed */
+	FHeightfieldDataPtr Data;
+};
+
+/** A tile of a streaming terrain, either loading or in place */
+USTRUCT()
+struct FHeightfieldStreamingTile
+{
+	GENERATED_BODY()
+
+	UPROPERTY(Transient)
+	TObjectPtr<UHeightfieldMeshComponent> Mesh;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UHeightfieldMeshCollisionComponent> Collision;
+
+	/** Heights of the tile, shared by its mesh and collision */
+	FHeightfieldDataPtr Data;
+
+	/** Read in flight, null once the tile is in place */
+	TSharedPtr<FHeightfieldStreamingLoad, ESPMode::ThreadSafe> Load;
+
+	/** Estimated resident memory of the tile in bytes */
+	int64 MemoryEstimate = 0;
+};
+
+/**
+ * Terrain streamed from a tiled heightfield file (see FHeightfieldTiledFile) around every player view
+ * and every extra streaming source, so the world can be far larger than what fits in memory at once.
+ *
+ * The heightfield is cut into square tiles, each with its own mesh and collision component.
+ * Tiles are read and meshed on background tasks, tiles that fall out of range are released, and
+ * the estimated memory of all tiles never exceeds the budget; when it would, the tiles nearest to a
+ * source win. Neighbouring tiles share their border samples, and every tile also reads the ring of
+ * samples around it, so positions, collision and normals line up across tile borders.
+ *
+ * The mesh and collision settings of the tiles come from the MeshSettings and CollisionSettings
+ * components; their heightmap textures are ignored. The terrain is placed like a single heightfield
+ * component: sample (0, 0) at the actor location.
+ */
+UCLASS()
+class TESTVEHICLEGAME_API AHeightfieldStreamingTerrain : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	AHeightfieldStreamingTerrain(const FObjectInitializer& ObjectInitializer);
+
+	//~ Begin AActor Interface
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual void Tick(float DeltaSeconds) override;
+	//~ End AActor Interface
+
+	/** Streams tiles around an actor as well, e.g. an AI vehicle. Player views are always streamed around */
+	UFUNCTION(BlueprintCallable, Category="Streaming")
+	void AddStreamingSource(AActor* Source);
+
+	UFUNCTION(BlueprintCallable, Category="Streaming")
+	void RemoveStreamingSource(AActor* Source);
+
+	/** Loads the tiles around the current sources and blocks until they are in place, e.g. before vehicles spawn */
+	UFUNCTION(BlueprintCallable, Category="Streaming")
+	void FlushStreaming();
+
+	/** Number of tiles in place or loading */
+	UFUNCTION(BlueprintPure, Category="Streaming")
+	int32 GetNumResidentTiles() const { return Tiles.Num(); }
+
+	/** Estimated memory of the tiles in place or loading, in bytes */
+	int64 GetResidentMemory() const;
+
+protected:
+	/** Tiled heightfield file, relative to the project directory */
+	UPROPERTY(EditAnywhere, Category="Streaming", meta=(FilePathFilter="Tiled heightfield (*.hft)|*.hft"))
+	FFilePath TiledHeightmapFile;
+
+	/** Cells along each side of a tile. Best a multiple of the file's tile size, so a tile maps few file tiles */
+	UPROPERTY(EditAnywhere, Category="Streaming", meta=(ClampMin="16", ClampMax="4096"))
+	int32 TileSize = 256;
+
+	/** Tiles closer than this to a streaming source are loaded */
+	UPROPERTY(EditAnywhere, Category="Streaming", meta=(ClampMin="0.0"))
+	float LoadRadius = 50000.0f;
+
+	/** Tiles further than this from every streaming source are released. Larger than LoadRadius, so tiles don't flicker at the edge */
+	UPROPERTY(EditAnywhere, Category="Streaming", meta=(ClampMin="0.0"))
+	float UnloadRadius = 60000.0f;
+
+	/** Hard limit on the estimated memory (CPU and GPU) of all tiles, in megabytes */
+	UPROPERTY(EditAnywhere, Category="Streaming", meta=(ClampMin="1"))
+	int32 MemoryBudgetMB = 512;
+
+	/** Tile reads running at once */
+	UPROPERTY(EditAnywhere, Category="Streaming", meta=(ClampMin="1"))
+	int32 MaxConcurrentLoads = 4;
+
+	/** Seconds between updates of the set of wanted tiles */
+	UPROPERTY(EditAnywhere, Category="Streaming", meta=(ClampMin="0.0"))
+	float UpdateInterval = 0.25f;
+
+	/** Mesh settings of every tile (scale, material, LOD, ...). Never registered itself */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="Streaming")
+	TObjectPtr<UHeightfieldMeshComponent> MeshSettings;
+
+	/** Collision settings of every tile (scale, physical materials, collision profile, ...). Never registered itself */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="Streaming")
+	TObjectPtr<UHeightfieldMeshCollisionComponent> CollisionSettings;
+
+private:
+	/** Recomputes the wanted tiles, releases the others and starts reads of missing ones */
+	void UpdateStreaming();
+
+	/** Puts tiles whose reads have finished in place */
+	void CompleteFinishedLoads();
+
+	void StartTileLoad(const FIntPoint& TileCoord);
+
+	/** Creates the mesh and collision of a tile once its heights are read */
+	void CompleteTileLoad(const FIntPoint& TileCoord, FHeightfieldStreamingTile& Tile);
+
+	void ReleaseTile(FHeightfieldStreamingTile& Tile);
+
+	void ReleaseAllTiles();
+
+	/** Samples of a tile, Max exclusive. Includes the border samples shared with the next tiles */
+	FIntRect GetTileSamples(const FIntPoint& TileCoord) const;
+
+	/** Conservative estimate of the CPU and GPU memory a tile keeps resident, in bytes */
+	int64 EstimateTileMemory(const FIntPoint& TileCoord) const;
+
+	/** Streaming source locations in actor space, without the actor scale */
+	void GatherSourceLocations(TArray<FVector2D>& OutLocations) const;
+
+	/** Spacing of the samples in world units, actor scale included, to match the unscaled source locations */
+	FVector2D GetSampleSpacing() const;
+
+	/** Distance from an actor space location to the area covered by a tile */
+	double GetTileDistance(const FIntPoint& TileCoord, const FVector2D& Location) const;
+
+	FHeightfieldTiledFilePtr File;
+
+	/** Number of tiles along X and Y */
+	FIntPoint NumTiles = FIntPoint::ZeroValue;
+
+	UPROPERTY(Transient)
+	TMap<FIntPoint, FHeightfieldStreamingTile> Tiles;
+
+	/** Reads of tiles released while loading, kept until they finish so they still count against MaxConcurrentLoads */
+	TArray<UE::Tasks::FTask> AbandonedLoads;
+
+	UPROPERTY(Transient)
+	TArray<TWeakObjectPtr<AActor>> ExtraSources;
+
+	float TimeSinceUpdate = 0.0f;
+};
@@ -0,0 +1,419 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "HeightfieldTiledFile.h"
+#include "Engine/Texture2D.h"
+#include "Async/MappedFileHandle.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+
+// Tiles start on page boundaries, so mapping one never touches its neighbours
+static constexpr int64 TILED_FILE_ALIGNMENT = 4096;
+
+FHeightfieldTiledFileTile::~FHeightfieldTiledFileTile()
+{
+	// Unmap before the file handle can go away
+	Region.Reset();
+}
+
+FHeightfieldTiledFilePtr FHeightfieldTiledFile::Open(const FString& Filename)
+{
+	// Header and tile index are small, read them with a regular file reader
+	TUniquePtr<FArchive> Reader(IFileManager::Get().CreateFileReader(*Filename));
+	if (!Reader)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("HeightfieldTiledFile: Can't open %s"), *Filename);
+		return nullptr;
+	}
+
+	FHeightfieldTiledFilePtr File = MakeShareable(new FHeightfieldTiledFile());
+
+	uint32 Magic = 0, Version = 0;
+	*Reader << Magic << Version;
+	if (Magic != FileMagic || Version != FileVersion)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("HeightfieldTiledFile: %s is not a tiled heightfield file of version %u"), *Filename, FileVersion);
+		return nullptr;
+	}
+
+	*Reader << File->Width << File->Height << File->TileSize << File->NumTilesX << File->NumTilesY;
+	if (File->Width < 1 || File->Height < 1 || File->TileSize < 1 ||
+		File->NumTilesX != FMath::DivideAndRoundUp(File->Width, File->TileSize) ||
+		File->NumTilesY != FMath::DivideAndRoundUp(File->Height, File->TileSize))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("HeightfieldTiledFile: %s has an invalid header"), *Filename);
+		return nullptr;
+	}
+
+	File->TileIndex.SetNum(File->NumTilesX * File->NumTilesY);
+	for (FTileEntry& Entry : File->TileIndex)
+	{
+		*Reader << Entry;
+	}
+
+	if (Reader->IsError())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("HeightfieldTiledFile: Failed to read the tile index of %s"), *Filename);
+		return nullptr;
+	}
+	Reader.Reset();
+
+	FOpenMappedResult MappedResult = FPlatformFileManager::Get().GetPlatformFile().OpenMappedEx(*Filename);
+	if (MappedResult.HasError())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("HeightfieldTiledFile: Can't map %s"), *Filename);
+		return nullptr;
+	}
+	File->MappedFile = TSharedPtr<IMappedFileHandle, ESPMode::ThreadSafe>(MappedResult.StealValue().Release());
+
+	const int64 TileBytes = static_cast<int64>(File->TileSize) * File->TileSize * (sizeof(uint16) + sizeof(uint8));
+	for (const FTileEntry& Entry : File->TileIndex)
+	{
+		if (Entry.Size != TileBytes || static_cast<int64>(Entry.Offset + Entry.Size) > File->MappedFile->GetFileSize())
+		{
+			UE_LOG(LogTemp, Warning, TEXT("HeightfieldTiledFile: %s is truncated or has an invalid tile index"), *Filename);
+			return nullptr;
+		}
+	}
+
+	return File;
+}
+
+bool FHeightfieldTiledFile::Write(const FString& Filename, TConstArrayView<uint16> Heights, TConstArrayView<uint8> MaterialIndices, int32 InWidth, int32 InHeight, int32 InTileSize)
+{
+	if (InWidth < 1 || InHeight < 1 || InTileSize < 1 || Heights.Num() != InWidth * InHeight || MaterialIndices.Num() != InWidth * InHeight)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("HeightfieldTiledFile: Invalid heightfield %d x %d with %d heights"), InWidth, InHeight, Heights.Num());
+		return false;
+	}
+
+	TUniquePtr<FArchive> Writer(IFileManager::Get().CreateFileWriter(*Filename));
+	if (!Writer)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("HeightfieldTiledFile: Can't write %s"), *Filename);
+		return false;
+	}
+
+	int32 TilesX = FMath::DivideAndRoundUp(InWidth, InTileSize);
+	int32 TilesY = FMath::DivideAndRoundUp(InHeight, InTileSize);
+	uint32 Magic = FileMagic;
+	uint32 Version = FileVersion;
+	*Writer << Magic << Version << InWidth << InHeight << InTileSize << TilesX << TilesY;
+
+	// Tiles follow the index back to back, each padded to the alignment
+	const int64 HeaderBytes = Writer->Tell() + static_cast<int64>(TilesX) * TilesY * (sizeof(uint64) + 2 * sizeof(uint32));
+	const int64 TileBytes = static_cast<int64>(InTileSize) * InTileSize * (sizeof(uint16) + sizeof(uint8));
+	const int64 TileStride = Align(TileBytes, TILED_FILE_ALIGNMENT);
+	const int64 FirstTileOffset = Align(HeaderBytes, TILED_FILE_ALIGNMENT);
+	for (int32 TileNumber = 0; TileNumber < TilesX * TilesY; ++TileNumber)
+	{
+		FTileEntry Entry;
+		Entry.Offset = FirstTileOffset + TileNumber * TileStride;
+		Entry.Size = static_cast<uint32>(TileBytes);
+		*Writer << Entry;
+	}
+
+	TArray<uint8> Padding;
+	Padding.SetNumZeroed(TILED_FILE_ALIGNMENT);
+	Writer->Serialize(Padding.GetData(), FirstTileOffset - Writer->Tell());
+
+	TArray<uint16> TileHeights;
+	TArray<uint8> TileMaterials;
+	TileHeights.SetNumUninitialized(InTileSize * InTileSize);
+	TileMaterials.SetNumUninitialized(InTileSize * InTileSize);
+	for (int32 TileY = 0; TileY < TilesY; ++TileY)
+	{
+		for (int32 TileX = 0; TileX < TilesX; ++TileX)
+		{
+			// Samples past the edge repeat the last row and column
+			for (int32 Y = 0; Y < InTileSize; ++Y)
+			{
+				const int32 SourceY = FMath::Min(TileY * InTileSize + Y, InHeight - 1);
+				for (int32 X = 0; X < InTileSize; ++X)
+				{
+					const int32 SourceIndex = SourceY * InWidth + FMath::Min(TileX * InTileSize + X, InWidth - 1);
+					TileHeights[Y * InTileSize + X] = Heights[SourceIndex];
+					TileMaterials[Y * InTileSize + X] = MaterialIndices[SourceIndex];
+				}
+			}
+
+			Writer->Serialize(TileHeights.GetData(), TileHeights.Num() * sizeof(uint16));
+			Writer->Serialize(TileMaterials.GetData(), TileMaterials.Num());
+			Writer->Serialize(Padding.GetData(), TileStride - TileBytes);
+		}
+	}
+
+	const bool bSuccess = !Writer->IsError() && Writer->Close();
+	UE_LOG(LogTemp, Log, TEXT("HeightfieldTiledFile: Wrote %s (%d x %d, %d x %d tiles of %d)"),
+		*Filename, InWidth, InHeight, TilesX, TilesY, InTileSize);
+	return bSuccess;
+}
+
+bool FHeightfieldTiledFile::ImportTexture(const UTexture2D* Texture, const FString& Filename)
+{
+	const FHeightfieldDataPtr Data = FHeightfieldData::CreateFromTexture(Texture);
+	if (!Data.IsValid())
+	{
+		return false;
+	}
+
+	// GetHeights is empty while the heights are compressed, copy them out either way
+	TArray<uint16> Heights;
+	Heights.SetNumUninitialized(Data->GetWidth() * Data->GetHeight());
+	Data->CopyHeights(0, 0, Data->GetHeight(), Data->GetWidth(), Heights);
+
+	return Write(Filename, Heights, Data->GetMaterialIndices(), Data->GetWidth(), Data->GetHeight());
+}
+
+bool FHeightfieldTiledFile::ImportRaw(const FString& RawFilename, int32 InWidth, int32 InHeight, const FString& Filename)
+{
+	TArray<uint8> RawBytes;
+	if (!FFileHelper::LoadFileToArray(RawBytes, *RawFilename))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("HeightfieldTiledFile: Can't read %s"), *RawFilename);
+		return false;
+	}
+
+	const int32 NumSamples = RawBytes.Num() / sizeof(uint16);
+	if (InWidth <= 0 || InHeight <= 0)
+	{
+		InWidth = InHeight = FMath::FloorToInt32(FMath::Sqrt(static_cast<double>(NumSamples)));
+	}
+
+	if (static_cast<int64>(InWidth) * InHeight != NumSamples || RawBytes.Num() % sizeof(uint16) != 0)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("HeightfieldTiledFile: %s has %d bytes, which doesn't match %d x %d 16-bit heights"),
+			*RawFilename, RawBytes.Num(), InWidth, InHeight);
+		return false;
+	}
+
+	TArray<uint16> Heights;
+	Heights.SetNumUninitialized(NumSamples);
+	FMemory::Memcpy(Heights.GetData(), RawBytes.GetData(), NumSamples * sizeof(uint16));
+	RawBytes.Empty();
+
+	TArray<uint8> MaterialIndices;
+	MaterialIndices.SetNumZeroed(NumSamples);
+
+	return Write(Filename, Heights, MaterialIndices, InWidth, InHeight);
+}
+
+FHeightfieldTiledFileTilePtr FHeightfieldTiledFile::GetTile(int32 TileX, int32 TileY)
+{
+	if (TileX < 0 || TileY < 0 || TileX >= NumTilesX || TileY >= NumTilesY)
+	{
+		return nullptr;
+	}
+
+	const int32 TileIndexValue = TileY * NumTilesX + TileX;
+
+	FScopeLock Lock(&CacheLock);
+
+	if (FCachedTile* Cached = CachedTiles.Find(TileIndexValue))
+	{
+		Cached->LastUsed = ++UseCounter;
+		return Cached->Tile;
+	}
+
+	const FTileEntry& Entry = TileIndex[TileIndexValue];
+	IMappedFileRegion* Region = MappedFile->MapRegion(Entry.Offset, Entry.Size);
+	if (!Region)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("HeightfieldTiledFile: Failed to map tile (%d, %d)"), TileX, TileY);
+		return nullptr;
+	}
+
+	FHeightfieldTiledFileTile* Tile = new FHeightfieldTiledFileTile();
+	Tile->MappedFile = MappedFile;
+	Tile->Region.Reset(Region);
+	Tile->TileSize = TileSize;
+	Tile->Heights = reinterpret_cast<const uint16*>(Region->GetMappedPtr());
+	Tile->MaterialIndices = Region->GetMappedPtr() + TileSize * TileSize * sizeof(uint16);
+
+	FCachedTile& Cached = CachedTiles.Add(TileIndexValue);
+	Cached.Tile = FHeightfieldTiledFileTilePtr(Tile);
+	Cached.LastUsed = ++UseCounter;
+
+	// Copy before trimming, it may unmap this very tile if the cache is tiny
+	const FHeightfieldTiledFileTilePtr Result = Cached.Tile;
+	TrimCache();
+	return Result;
+}
+
+FHeightfieldDataPtr FHeightfieldTiledFile::ReadRegion(const FIntRect& Samples, bool bWithApron)
+{
+	const FIntRect Clamped(
+		FMath::Max(Samples.Min.X, 0), FMath::Max(Samples.Min.Y, 0),
+		FMath::Min(Samples.Max.X, Width), FMath::Min(Samples.Max.Y, Height));
+	const int32 RegionWidth = Clamped.Width();
+	const int32 RegionHeight = Clamped.Height();
+	if (RegionWidth <= 0 || RegionHeight <= 0)
+	{
+		return nullptr;
+	}
+
+	TArray<uint16> Heights;
+	TArray<uint8> MaterialIndices;
+	if (!bWithApron)
+	{
+		return ReadSamples(Clamped, Heights, MaterialIndices) ?
+			FHeightfieldData::CreateFromHeights(MoveTemp(Heights), MoveTemp(MaterialIndices), RegionWidth, RegionHeight) : nullptr;
+	}
+
+	// Read the region grown by one sample, as far as the heightfield goes
+	const FIntRect Grown(
+		FMath::Max(Clamped.Min.X - 1, 0), FMath::Max(Clamped.Min.Y - 1, 0),
+		FMath::Min(Clamped.Max.X + 1, Width), FMath::Min(Clamped.Max.Y + 1, Height));
+	TArray<uint16> GrownHeights;
+	TArray<uint8> GrownMaterialIndices;
+	if (!ReadSamples(Grown, GrownHeights, GrownMaterialIndices))
+	{
+		return nullptr;
+	}
+
+	const int32 GrownWidth = Grown.Width();
+	auto GetGrownIndex = [&Grown, GrownWidth](int32 X, int32 Y)
+	{
+		X = FMath::Clamp(X, Grown.Min.X, Grown.Max.X - 1);
+		Y = FMath::Clamp(Y, Grown.Min.Y, Grown.Max.Y - 1);
+		return (Y - Grown.Min.Y) * GrownWidth + (X - Grown.Min.X);
+	};
+
+	Heights.SetNumUninitialized(RegionWidth * RegionHeight);
+	MaterialIndices.SetNumUninitialized(RegionWidth * RegionHeight);
+	for (int32 Y = Clamped.Min.Y; Y < Clamped.Max.Y; ++Y)
+	{
+		const int32 RegionOffset = (Y - Clamped.Min.Y) * RegionWidth;
+		const int32 GrownOffset = GetGrownIndex(Clamped.Min.X, Y);
+		FMemory::Memcpy(&Heights[RegionOffset], &GrownHeights[GrownOffset], RegionWidth * sizeof(uint16));
+		FMemory::Memcpy(&MaterialIndices[RegionOffset], &GrownMaterialIndices[GrownOffset], RegionWidth);
+	}
+
+	// Same layout as FHeightfieldData::SetApronHeights expects
+	TArray<uint16> ApronHeights;
+	ApronHeights.Reserve(2 * (RegionWidth + 2) + 2 * RegionHeight);
+	for (int32 X = Clamped.Min.X - 1; X <= Clamped.Max.X; ++X)
+	{
+		ApronHeights.Add(GrownHeights[GetGrownIndex(X, Clamped.Min.Y - 1)]);
+	}
+	for (int32 X = Clamped.Min.X - 1; X <= Clamped.Max.X; ++X)
+	{
+		ApronHeights.Add(GrownHeights[GetGrownIndex(X, Clamped.Max.Y)]);
+	}
+	for (int32 Y = Clamped.Min.Y; Y < Clamped.Max.Y; ++Y)
+	{
+		ApronHeights.Add(GrownHeights[GetGrownIndex(Clamped.Min.X - 1, Y)]);
+	}
+	for (int32 Y = Clamped.Min.Y; Y < Clamped.Max.Y; ++Y)
+	{
+		ApronHeights.Add(GrownHeights[GetGrownIndex(Clamped.Max.X, Y)]);
+	}
+
+	FHeightfieldDataPtr Data = FHeightfieldData::CreateFromHeights(MoveTemp(Heights), MoveTemp(MaterialIndices), RegionWidth, RegionHeight);
+	if (Data.IsValid())
+	{
+		Data->SetApronHeights(MoveTemp(ApronHeights));
+	}
+	return Data;
+}
+
+bool FHeightfieldTiledFile::ReadSamples(const FIntRect& Samples, TArray<uint16>& OutHeights, TArray<uint8>& OutMaterialIndices)
+{
+	const int32 RegionWidth = Samples.Width();
+	OutHeights.SetNumUninitialized(RegionWidth * Samples.Height());
+	OutMaterialIndices.SetNumUninitialized(RegionWidth * Samples.Height());
+
+	for (int32 TileY = Samples.Min.Y / TileSize; TileY <= (Samples.Max.Y - 1) / TileSize; ++TileY)
+	{
+		for (int32 TileX = Samples.Min.X / TileSize; TileX <= (Samples.Max.X - 1) / TileSize; ++TileX)
+		{
+			const FHeightfieldTiledFileTilePtr Tile = GetTile(TileX, TileY);
+			if (!Tile.IsValid())
+			{
+				return false;
+			}
+
+			// Overlap of the region with the tile, in heightfield samples
+			const int32 X0 = FMath::Max(Samples.Min.X, TileX * TileSize);
+			const int32 Y0 = FMath::Max(Samples.Min.Y, TileY * TileSize);
+			const int32 X1 = FMath::Min(Samples.Max.X, (TileX + 1) * TileSize);
+			const int32 Y1 = FMath::Min(Samples.Max.Y, (TileY + 1) * TileSize);
+			for (int32 Y = Y0; Y < Y1; ++Y)
+			{
+				const int32 TileOffset = (Y - TileY * TileSize) * TileSize + (X0 - TileX * TileSize);
+				const int32 RegionOffset = (Y - Samples.Min.Y) * RegionWidth + (X0 - Samples.Min.X);
+				FMemory::Memcpy(&OutHeights[RegionOffset], &Tile->Heights[TileOffset], (X1 - X0) * sizeof(uint16));
+				FMemory::Memcpy(&OutMaterialIndices[RegionOffset], &Tile->MaterialIndices[TileOffset], X1 - X0);
+			}
+		}
+	}
+
+	return true;
+}
+
+void FHeightfieldTiledFile::SetMaxMappedTiles(int32 InMaxMappedTiles)
+{
+	FScopeLock Lock(&CacheLock);
+	MaxMappedTiles = FMath::Max(1, InMaxMappedTiles);
+	TrimCache();
+}
+
+void FHeightfieldTiledFile::ReleaseTiles()
+{
+	FScopeLock Lock(&CacheLock);
+	CachedTiles.Reset();
+}
+
+void FHeightfieldTiledFile::TrimCache()
+{
+	while (CachedTiles.Num() > MaxMappedTiles)
+	{
+		int32 OldestTile = INDEX_NONE;
+		uint64 OldestUse = MAX_uint64;
+		for (const TPair<int32, FCachedTile>& Pair : CachedTiles)
+		{
+			if (Pair.Value.LastUsed < OldestUse)
+			{
+				OldestUse = Pair.Value.LastUsed;
+				OldestTile = Pair.Key;
+			}
+		}
+		CachedTiles.Remove(OldestTile);
+	}
+}
+
+/** HeightfieldMesh.ImportTiled <Texture path | .r16/.raw file> <Output file> [Width Height] */
+static void ImportTiledHeightfield(const TArray<FString>& Args)
+{
+	if (Args.Num() < 2)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("HeightfieldTiledFile: Usage: HeightfieldMesh.ImportTiled <Texture path | .r16/.raw file> <Output file> [Width Height]"));
+		return;
+	}
+
+	const FString& Source = Args[0];
+	const FString& Destination = Args[1];
+	const FString Extension = FPaths::GetExtension(Source);
+	if (Extension == TEXT("r16") || Extension == TEXT("raw"))
+	{
+		const int32 Width = Args.Num() > 3 ? FCString::Atoi(*Args[2]) : 0;
+		const int32 Height = Args.Num() > 3 ? FCString::Atoi(*Args[3]) : 0;
+		FHeightfieldTiledFile::ImportRaw(Source, Width, Height, Destination);
+	}
+	else if (const UTexture2D* Texture = LoadObject<UTexture2D>(nullptr, *Source))
+	{
+		FHeightfieldTiledFile::ImportTexture(Texture, Destination);
+	}
+	else
+	{
+		UE_LOG(LogTemp, Warning, TEXT("HeightfieldTiledFile: %s is neither a .r16/.raw file nor a texture"), *Source);
+	}
+}
+
+static FAutoConsoleCommand GHeightfieldImportTiledCommand(
+	TEXT("HeightfieldMesh.ImportTiled"),
+	TEXT("Converts a BGRA8 heightmap texture or a .r16/.raw file into a tiled heightfield file. Arguments: <Texture path | .r16/.raw file> <Output file> [Width Height]"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&ImportTiledHeightfield));
@@ -0,0 +1,136 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HeightfieldData.h"
+
+class IMappedFileHandle;
+class IMappedFileRegion;
+
+/** One tile of a tiled heightfield file, mapped into memory for as long as anyone holds it */
+struct TESTVEHICLEGAME_API FHeightfieldTiledFileTile
+{
+	~FHeightfieldTiledFileTile();
+
+	/** TileSize x TileSize heights, row-major. Samples past the heightfield edge repeat the edge */
+	const uint16* Heights = nullptr;
+
+	/** TileSize x TileSize material indices, row-major */
+	const uint8* MaterialIndices = nullptr;
+
+	int32 TileSize = 0;
+
+private:
+	friend class FHeightfieldTiledFile;
+
+	/** Keeps the file mapping alive while the region is */
+	TSharedPtr<IMappedFileHandle, ESPMode::ThreadSafe> MappedFile;
+
+	TUniquePtr<IMappedFileRegion> Region;
+};
+
+using FHeightfieldTiledFileTilePtr = TSharedPtr<const FHeightfieldTiledFileTile, ESPMode::ThreadSafe>;
+
+/**
+ * Native tiled heightmap file, read through a memory-mapped file handle.
+ * Tiles are mapped on first access, so a huge heightfield never has to be resident as a whole;
+ * the least recently used tiles are unmapped once more than MaxMappedTiles are mapped.
+ *
+ * Layout (little-endian):
+ * - Header: magic, version, width, height, tile size, tile counts
+ * - Tile index: file offset and size of every tile, row-major
+ * - Tiles, page aligned: TileSize^2 uint16 heights followed by TileSize^2 uint8 material indices
+ *
+ * Files are created from a BGRA8 heightmap texture or a .r16/.raw height file with the
+ * importers below, or with the HeightfieldMesh.ImportTiled console command.
+ */
+class TESTVEHICLEGAME_API FHeightfieldTiledFile
+{
+public:
+	static constexpr uint32 FileMagic = 0x4C544648; // "HFTL"
+	static constexpr uint32 FileVersion = 1;
+	static constexpr int32 DefaultTileSize = 256;
+
+	/** Opens a tiled heightfield file, returns null if it can't be mapped or isn't one */
+	static TSharedPtr<FHeightfieldTiledFile, ESPMode::ThreadSafe> Open(const FString& Filename);
+
+	/** Writes heights and per-sample material indices (row-major, Width * Height each) as a tiled file */
+	static bool Write(const FString& Filename, TConstArrayView<uint16> Heights, TConstArrayView<uint8> MaterialIndices, int32 InWidth, int32 InHeight, int32 InTileSize = DefaultTileSize);
+
+	/** Converts a BGRA8 heightmap texture into a tiled file */
+	static bool ImportTexture(const UTexture2D* Texture, const FString& Filename);
+
+	/**
+	 * Converts a headerless little-endian 16-bit height file (.r16/.raw) into a tiled file.
+	 * InWidth and InHeight can be 0 for a square heightmap. All material indices are 0.
+	 */
+	static bool ImportRaw(const FString& RawFilename, int32 InWidth, int32 InHeight, const FString& Filename);
+
+	int32 GetWidth() const { return Width; }
+	int32 GetHeight() const { return Height; }
+	int32 GetTileSize() const { return TileSize; }
+	int32 GetNumTilesX() const { return NumTilesX; }
+	int32 GetNumTilesY() const { return NumTilesY; }
+
+	/** A tile, mapped on first access. Safe to call from any thread */
+	FHeightfieldTiledFileTilePtr GetTile(int32 TileX, int32 TileY);
+
+	/**
+	 * Copies a sample rectangle (Max exclusive, clamped to the heightfield) into new heightfield data,
+	 * mapping only the tiles it touches. Safe to call from any thread.
+	 *
+	 * @param bWithApron - Also read the ring of samples around the rectangle into the apron of the data
+	 *                     (see FHeightfieldData::SetApronHeights); past the heightfield edge it repeats the edge
+	 */
+	FHeightfieldDataPtr ReadRegion(const FIntRect& Samples, bool bWithApron = false);
+
+	/** Number of tiles kept mapped after their last use */
+	void SetMaxMappedTiles(int32 InMaxMappedTiles);
+
+	/** Drops every cached tile mapping; tiles still held elsewhere stay mapped until released */
+	void ReleaseTiles();
+
+private:
+	struct FTileEntry
+	{
+		uint64 Offset = 0;
+		uint32 Size = 0;
+		uint32 Flags = 0;
+
+		friend FArchive& operator<<(FArchive& Ar, FTileEntry& Entry)
+		{
+			return Ar << Entry.Offset << Entry.Size << Entry.Flags;
+		}
+	};
+
+	struct FCachedTile
+	{
+		FHeightfieldTiledFileTilePtr Tile;
+		uint64 LastUsed = 0;
+	};
+
+	FHeightfieldTiledFile() = default;
+
+	/** Copies a sample rectangle that lies inside the heightfield (Max exclusive) into row-major arrays */
+	bool ReadSamples(const FIntRect& Samples, TArray<uint16>& OutHeights, TArray<uint8>& OutMaterialIndices);
+
+	/** Unmaps least recently used tiles until at most MaxMappedTiles are cached. Expects CacheLock to be held */
+	void TrimCache();
+
+	TSharedPtr<IMappedFileHandle, ESPMode::ThreadSafe> MappedFile;
+
+	int32 Width = 0;
+	int32 Height = 0;
+	int32 TileSize = 0;
+	int32 NumTilesX = 0;
+	int32 NumTilesY = 0;
+	TArray<FTileEntry> TileIndex;
+
+	FCriticalSection CacheLock;
+	TMap<int32, FCachedTile> CachedTiles;
+	uint64 UseCounter = 0;
+	int32 MaxMappedTiles = 64;
+};
+
+using FHeightfieldTiledFilePtr = TSharedPtr<FHeightfieldTiledFile, ESPMode::ThreadSafe>;